@@ -0,0 +1,59 @@
+#include <fstream>
+
+#include "asyncwriter.h"
+
+using namespace std;
+
+AsyncWriter &AsyncWriter::instance() {
+  static AsyncWriter writer;
+  return writer;
+}
+
+AsyncWriter::AsyncWriter() : _thread(&AsyncWriter::run, this) {}
+
+AsyncWriter::~AsyncWriter() {
+  {
+    lock_guard<mutex> lock(_mutex);
+    _stop = true;
+  }
+  _changed.notify_all();
+  _thread.join();
+}
+
+void AsyncWriter::write(string filename, Printer printer) {
+  unique_lock<mutex> lock(_mutex);
+  _changed.wait(lock, [this] { return _queue.size() < MaxQueued; });
+  _queue.emplace_back(std::move(filename), std::move(printer));
+  _changed.notify_all();
+}
+
+void AsyncWriter::flush() {
+  unique_lock<mutex> lock(_mutex);
+  _changed.wait(lock, [this] { return _queue.empty() && !_busy; });
+}
+
+void AsyncWriter::run() {
+  unique_lock<mutex> lock(_mutex);
+  while( true) {
+    // finish the queue before stopping
+    _changed.wait(lock, [this] { return _stop || !_queue.empty(); });
+    if( _queue.empty()) return;
+
+    auto job = std::move(_queue.front());
+    _queue.pop_front();
+    _busy = true;
+    _changed.notify_all();
+    lock.unlock();
+
+    ofstream os(job.first, ofstream::trunc);
+    if( os) {
+      job.second(os);
+      os.close();
+    }
+    if( !os) cerr << "AsyncWriter: could not write " << job.first << endl;
+
+    lock.lock();
+    _busy = false;
+    _changed.notify_all();
+  }
+}
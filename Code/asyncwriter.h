@@ -0,0 +1,46 @@
+#pragma once
+
+#include <condition_variable>
+#include <deque>
+#include <functional>
+#include <iostream>
+#include <mutex>
+#include <string>
+#include <thread>
+
+/**
+ *  AsyncWriter.h
+ *
+ *  Writes files on a background thread, so that the AFEM loops do not wait
+ *  for formatting and disk I/O.  A caller takes a flat copy of what it wants
+ *  to print, which is cheap compared to formatting it, and hands over a
+ *  printer that formats that copy.  Files are written in the order they were
+ *  handed over.  At most MaxQueued files are pending; write() blocks beyond
+ *  that, so memory stays bounded when the disk cannot keep up.
+ *
+ *  Pending files are written before the program exits normally.
+ */
+class AsyncWriter {
+public:
+  typedef std::function<void(std::ostream &)> Printer;
+  static const size_t MaxQueued = 4;
+
+  static AsyncWriter &instance();
+
+  void write(std::string filename, Printer printer);
+
+  // waits until all files handed over so far are written
+  void flush();
+
+  ~AsyncWriter();
+
+private:
+  AsyncWriter();
+  void run();
+
+  std::deque<std::pair<std::string, Printer>> _queue;
+  bool _busy = false, _stop = false;
+  std::mutex _mutex;
+  std::condition_variable _changed;
+  std::thread _thread;
+};
@@ -10,38 +10,67 @@
 
 using namespace std;
 
-Basis::Basis(std::string dirname, int tt, bool bin) {
-  string ext = to_string(tt) + ".mat";
-  _type = TriType(tt);
-
-  // load the element vector from file
-  _eltvec = readVector(dirname + "eltvec_" + ext, bin);
-  _dim = _eltvec.rows();
-
-  // load the parts of the element matrix from file
-  _eltmat.push_back(readMatrix(dirname + "eltmat0_" + ext, bin));
-  _eltmat.push_back(readMatrix(dirname + "eltmat1_" + ext, bin));
-  _eltmat.push_back(readMatrix(dirname + "eltmat2_" + ext, bin));
-  assert(_eltmat[0].rows() == _dim);
-  assert(_eltmat[1].rows() == _dim);
-  assert(_eltmat[2].rows() == _dim);
-
-  // load transfer matrices from file
-  _transfermat.push_back(readMatrix(dirname + "transfermat0_" + ext, bin));
-  _transfermat.push_back(readMatrix(dirname + "transfermat1_" + ext, bin));
-  assert(_transfermat[0].rows() == _dim);
-  assert(_transfermat[1].rows() == _dim);
-
-  // load mass matrix from file
-  _massmat = readMatrix(dirname + "massmat_" + ext, bin);
-  assert(_massmat.rows() == _dim);
+Basis::Basis(shared_ptr<const BasisBundle> bundle, int tt)
+  : _bundle(std::move(bundle)), _dim(_bundle->dim()), _type(tt)
+{
+  assert(eltvec().rows() == _dim);
+  assert(eltmat(0).rows() == _dim);
+  assert(eltmat(1).rows() == _dim);
+  assert(eltmat(2).rows() == _dim);
+  assert(transfermat(0).rows() == _dim);
+  assert(transfermat(1).rows() == _dim);
+  assert(massmat().rows() == _dim);
 }
 
-Bases::Bases(string dirname, bool bin) {
-  // just load each basis into the vector
-  for( auto i = 0; i < 8; i++) {
-    _basis.push_back(Basis(dirname, i, bin));
-    if( i == 0) _dim = _basis[i]._dim;
-    else assert( _basis[i]._dim == _dim);
+Bases::Bases(string dirname, bool bin) : _bundle(BasisBundle::open(dirname, bin)) {
+  _dim = _bundle->dim();
+  for( auto i = 0; i < BasisBundle::NumTypes; i++) {
+    _basis.push_back(Basis(_bundle, i));
   }
 }
+
+const BasisEvaluator &Bases::evaluator() const {
+  std::call_once(_evaluatorCreated, [this] {
+    _evaluator.reset(new BasisEvaluator(Math::degree(_dim)));
+  });
+  return *_evaluator;
+}
+
+Vector Bases::transfer(int tt, unsigned path, int generations, const Vector &v) const {
+  assert(generations > 0 && generations <= MaxTransferGenerations);
+  int dim = v.rows();
+  assert(dim <= _dim);
+
+  if( generations > 1) {
+    std::shared_ptr<const Matrix> product;
+    {
+      std::lock_guard<std::mutex> lock(_transferPathsMutex);
+      TransferPath &tp = _transferPaths[make_tuple(tt, path, generations)];
+      if( tp.product && tp.product->rows() >= dim)
+        product = tp.product;
+      else if( ++tp.uses > dim) {
+        // multiply the transfer matrices from the top down
+        TriType type(tt);
+        Matrix res = Matrix::Identity(dim, dim);
+        for( int gen = 0; gen < generations; gen++) {
+          bool rightChild = (path >> gen) & 1;
+          res = _basis[type].transfermat(rightChild).topLeftCorner(dim, dim) * res;
+          type = rightChild ? type.right() : type.left();
+        }
+        product = tp.product = std::make_shared<const Matrix>(std::move(res));
+        tp.uses = 0;
+      }
+    }
+    if( product) return product->topLeftCorner(dim, dim) * v;
+  }
+
+  // apply the transfer matrices one generation at a time
+  TriType type(tt);
+  Vector res = v;
+  for( int gen = 0; gen < generations; gen++) {
+    bool rightChild = (path >> gen) & 1;
+    res = _basis[type].transfermat(rightChild).topLeftCorner(dim, dim) * res;
+    type = rightChild ? type.right() : type.left();
+  }
+  return res;
+}
@@ -4,33 +4,44 @@
 #include <iostream>
 #include <string>
 #include <array>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <tuple>
 
 #include "hasdof.h"
 #include "matrix.h"
 #include "tritype.h"
+#include "basisevaluator.h"
+#include "basisbundle.h"
 
 class MatrixCombine;
 
+/**
+ *  The matrices of the basis of one tritype.  They are views into the
+ *  bundle of all bases, see basisbundle.h, and are not copied.
+ */
 class Basis : public HasDOF {
  public:
-  Basis(std::string dirname, int tt, bool bin = true);
+  Basis(std::shared_ptr<const BasisBundle> bundle, int tt);
 
   virtual int dof() const override { return _dim; }
   const TriType &type() const { return _type; }
-  const Matrix &eltmat(int i) const { return _eltmat[i]; }
-  const Matrix &transfermat(int i) const { return _transfermat[i]; }
-  const Matrix &massmat() const { return _massmat; }
-  const Vector &eltvec() const { return _eltvec; }
+  Eigen::Map<const Matrix> eltmat(int i) const {
+    return _bundle->matrix(_type, BasisBundle::Kind(BasisBundle::EltMat0 + i));
+  }
+  Eigen::Map<const Matrix> transfermat(int i) const {
+    return _bundle->matrix(_type, BasisBundle::Kind(BasisBundle::TransferMat0 + i));
+  }
+  Eigen::Map<const Matrix> massmat() const { return _bundle->matrix(_type, BasisBundle::MassMat); }
+  Eigen::Map<const Vector> eltvec() const { return _bundle->vector(_type, BasisBundle::EltVec); }
   int p() const { return _dim; }
 
   friend class Bases;
   friend class MatrixCombine;
 
  private:
-  std::vector<Matrix> _eltmat;
-  std::vector<Matrix> _transfermat;
-  Matrix _massmat;
-  Vector _eltvec;
+  std::shared_ptr<const BasisBundle> _bundle;
   int _dim;
   TriType _type;
 };
@@ -42,10 +53,40 @@ class Bases : public HasDOF {
 
   const Basis &basis(int tt) { return _basis[tt]; }
 
+  /**
+   *  Restricts the local vector `v` of an element of tritype `tt` over several
+   *  generations at once.  Bit i of `path` tells if generation i+1 is a right
+   *  child.  The transfer matrix of a child only depends on its tritype, which
+   *  follows from `tt` and the sides taken, so products along a path are 
+   *  cached by (tt, path, generations).  Such a product costs O(dim^3) to form
+   *  and saves O(generations * dim^2) per use, so it is only formed once the
+   *  path has been used more than dim times.
+   *
+   *  Restriction does not raise the degree, so the top-left corner of the 
+   *  product is the product of the top-left corners: one product at the 
+   *  largest dim so far serves all smaller ones.
+   */
+  static const int MaxTransferGenerations = 4;
+  Vector transfer(int tt, unsigned path, int generations, const Vector &v) const;
+
+  // point evaluation of the basis functions; created on first use
+  const BasisEvaluator &evaluator() const;
+
   virtual int dof() const override { return _dim; }
   friend class MatrixCombine;
 
  protected:
   int _dim;
+  std::shared_ptr<const BasisBundle> _bundle;
   std::vector<Basis> _basis;
+
+  mutable std::unique_ptr<BasisEvaluator> _evaluator;
+  mutable std::once_flag _evaluatorCreated;
+
+  struct TransferPath {
+    std::shared_ptr<const Matrix> product;
+    int uses = 0;
+  };
+  mutable std::map<std::tuple<int, unsigned, int>, TransferPath> _transferPaths;
+  mutable std::mutex _transferPathsMutex;
 };
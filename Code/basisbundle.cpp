@@ -0,0 +1,120 @@
+#include "basisbundle.h"
+
+#include <cstdio>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "degree.h"
+
+using namespace std;
+
+namespace {
+const char magic[8] = {'h', 'p', 'a', 'f', 'e', 'm', 'B', 'B'};
+const uint32_t version = 2;
+
+// the names of the separate files of the kinds
+const char *kindNames[] = {"eltvec", "eltmat0", "eltmat1", "eltmat2",
+                           "transfermat0", "transfermat1", "massmat"};
+
+uint64_t aligned(uint64_t offset) { return (offset + 63) & ~uint64_t(63); }
+}
+
+shared_ptr<const BasisBundle> BasisBundle::open(const string &dirname, bool bin) {
+  shared_ptr<BasisBundle> bundle(new BasisBundle());
+  string filename = dirname + "bundle.bin" + scalarname;
+  if( bin && bundle->map(filename)) return bundle;
+
+  bundle->assemble(dirname, bin);
+  if( bin) bundle->write(filename);
+  return bundle;
+}
+
+BasisBundle::~BasisBundle() {
+  if( _map) munmap(_map, _size);
+}
+
+bool BasisBundle::map(const string &filename) {
+  int fd = ::open(filename.c_str(), O_RDONLY);
+  if( fd == -1) return false;
+  struct stat st;
+  fstat(fd, &st);
+  size_t size = st.st_size;
+  void *m = size >= sizeof(Header) ? mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0) : MAP_FAILED;
+  close(fd);
+  if( m == MAP_FAILED) return false;
+
+  const Header *h = (const Header *) m;
+  if( memcmp(h->magic, magic, sizeof(magic)) != 0 || h->version != version
+      || h->scalarSize != sizeof(scalar)) {
+    cerr << "Ignoring " << filename << ": not a basis bundle of this version and scalar type" << endl;
+    munmap(m, size);
+    return false;
+  }
+
+  _map = m;
+  _size = size;
+  _base = (const char *) m;
+  const Entry &last = entry(NumTypes - 1, MassMat);
+  assert(last.offset + (uint64_t) last.rows*last.cols*sizeof(scalar) <= _size && "truncated basis bundle");
+  return true;
+}
+
+void BasisBundle::assemble(const string &dirname, bool bin) {
+  std::vector<Matrix> mats;
+  for( int tt = 0; tt < NumTypes; tt++) {
+    for( int kind = 0; kind < NumKinds; kind++) {
+      string filename = dirname + kindNames[kind] + "_" + to_string(tt) + ".mat";
+      if( kind == EltVec) mats.push_back(readVector(filename, bin));
+      else mats.push_back(readMatrix(filename, bin));
+      assert(mats.back().rows() == mats[0].rows());
+    }
+  }
+
+  Header h;
+  memset(&h, 0, sizeof(h));
+  memcpy(h.magic, magic, sizeof(magic));
+  h.version = version;
+  h.scalarSize = sizeof(scalar);
+  h.dim = mats[0].rows();
+  h.degree = Degree::dofToDegree(h.dim);
+
+  uint64_t offset = sizeof(Header) + NumTypes*NumKinds*sizeof(Entry);
+  std::vector<Entry> entries;
+  for( auto &mat : mats) {
+    offset = aligned(offset);
+    entries.push_back({offset, (uint32_t) mat.rows(), (uint32_t) mat.cols()});
+    offset += mat.size()*sizeof(scalar);
+  }
+
+  _image.assign(offset, 0);
+  char *base = _image.data();
+  memcpy(base, &h, sizeof(h));
+  memcpy(base + sizeof(h), entries.data(), entries.size()*sizeof(Entry));
+  for( size_t k = 0; k < mats.size(); k++) {
+    // assign elementwise, so that padding bytes of long doubles stay zero
+    scalar *dst = (scalar *) (base + entries[k].offset);
+    for( Eigen::Index i = 0; i < mats[k].size(); i++) dst[i] = mats[k].data()[i];
+  }
+  _base = base;
+  _size = _image.size();
+}
+
+void BasisBundle::write(const string &filename) const {
+  // concurrent runs may all write it; each writes its own file and renames
+  // it into place, which is atomic
+  string tmpfile = filename + ".tmp" + to_string(getpid());
+  ofstream os(tmpfile, ios::out | ios::binary | ios::trunc);
+  os.write(_base, _size);
+  os.close();
+  if( os.fail() || rename(tmpfile.c_str(), filename.c_str()) != 0) {
+    remove(tmpfile.c_str());
+    cerr << "Could not write the basis bundle " << filename << endl;
+    return;
+  }
+  cerr << "Wrote the basis bundle " << filename << endl;
+}
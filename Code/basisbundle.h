@@ -0,0 +1,73 @@
+#pragma once
+
+#include <cassert>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "matrix.h"
+
+/**
+ *  BasisBundle.h
+ *
+ *  All matrices of a set of bases in one block: for each of the 8 tritypes,
+ *  the element vector, the three parts of the element matrix, the two
+ *  transfer matrices and the mass matrix, column-major.  The index holds the
+ *  offset and size of every (tritype, kind).  The top-left block of a lower
+ *  degree lies in the leading columns, so a run that stays below some degree
+ *  only ever touches those pages.
+ *
+ *  The bundle lives in the file "bundle.bin" + scalarname in the bases
+ *  directory.  If it is there, it is mapped read-only: nothing is copied, and
+ *  processes using the same bases share the pages.  If not, the bundle is
+ *  assembled from the separate matrix files, and, like readMatrix does for
+ *  its binary files, written out for the next run.
+ */
+class BasisBundle {
+public:
+  enum Kind { EltVec, EltMat0, EltMat1, EltMat2, TransferMat0, TransferMat1, MassMat, NumKinds };
+  static const int NumTypes = 8;
+
+  static std::shared_ptr<const BasisBundle> open(const std::string &dirname, bool bin = true);
+  ~BasisBundle();
+
+  int dim() const { return header().dim; }
+
+  Eigen::Map<const Matrix> matrix(int tt, Kind kind) const {
+    const Entry &e = entry(tt, kind);
+    return Eigen::Map<const Matrix>((const scalar *) (_base + e.offset), e.rows, e.cols);
+  }
+  Eigen::Map<const Vector> vector(int tt, Kind kind) const {
+    const Entry &e = entry(tt, kind);
+    assert(e.cols == 1);
+    return Eigen::Map<const Vector>((const scalar *) (_base + e.offset), e.rows);
+  }
+
+private:
+  struct Header {
+    char magic[8];
+    uint32_t version, scalarSize, dim, degree;
+  };
+  struct Entry {
+    uint64_t offset;
+    uint32_t rows, cols;
+  };
+
+  // the file image: the header, the entries, the matrices
+  const char *_base = nullptr;
+  void *_map = nullptr;
+  size_t _size = 0;
+  std::vector<char> _image;
+
+  BasisBundle() = default;
+
+  const Header &header() const { return *(const Header *) _base; }
+  const Entry &entry(int tt, Kind kind) const {
+    return ((const Entry *) (_base + sizeof(Header)))[tt*NumKinds + kind];
+  }
+
+  bool map(const std::string &filename);
+  void assemble(const std::string &dirname, bool bin);
+  void write(const std::string &filename) const;
+};
@@ -0,0 +1,322 @@
+#include <cassert>
+#include <cmath>
+#include <Eigen/QR>
+
+#include "basisevaluator.h"
+#include "degree.h"
+#include "quadrature.h"
+
+using namespace std;
+
+BasisEvaluator::Jet BasisEvaluator::Jet::operator*(const Jet &o) const {
+  return {v*o.v,
+          x*o.v + v*o.x,
+          y*o.v + v*o.y,
+          xx*o.v + 2*x*o.x + v*o.xx,
+          xy*o.v + x*o.y + y*o.x + v*o.xy,
+          yy*o.v + 2*y*o.y + v*o.yy};
+}
+
+BasisEvaluator::Jet BasisEvaluator::Jet::operator+(const Jet &o) const {
+  return {v+o.v, x+o.x, y+o.y, xx+o.xx, xy+o.xy, yy+o.yy};
+}
+
+namespace {
+typedef BasisEvaluator::Jet Jet;
+
+Jet linear(scalar c, scalar a, scalar b) { return {c, a, b, 0, 0, 0}; }
+
+// the barycentric coordinates L1, L2, L3 at (x, y)
+array<Jet, 3> barycentric(scalar x, scalar y) {
+  return {{linear(1 - x - y, -1, -1), linear(x, 1, 0), linear(y, 0, 1)}};
+}
+
+// P_0, ..., P_n and their first three derivatives at z
+void legendre(scalar z, int n, vector<array<scalar, 4>> &P) {
+  P.assign(n + 1, {{0, 0, 0, 0}});
+  P[0] = {{1, 0, 0, 0}};
+  if( n == 0) return;
+  P[1] = {{z, 1, 0, 0}};
+  for( int k = 1; k < n; k++) {
+    P[k+1][0] = ((2*k + 1) * z * P[k][0] - k * P[k-1][0]) / (k + 1);
+    for( int j = 1; j < 4; j++) {
+      P[k+1][j] = P[k-1][j] + (2*k + 1) * P[k][j-1];
+    }
+  }
+}
+
+// composes a polynomial in one variable (derivatives in p) with a linear jet
+Jet compose(const array<scalar, 4> &p, const Jet &l) {
+  return {p[0], p[1]*l.x, p[1]*l.y, p[2]*l.x*l.x, p[2]*l.x*l.y, p[2]*l.y*l.y};
+}
+
+int pairCantor(int x, int y) { return (x+y)*(x+y+1)/2 + y; }
+
+typedef Eigen::Array<scalar, Eigen::Dynamic, 1> Column;
+
+// P_0, ..., P_n and their first two derivatives at all of z, column-wise
+void legendre(const Column &z, int n, vector<array<Column, 3>> &P) {
+  Column zero = Column::Zero(z.rows());
+  P.assign(n + 1, {{zero, zero, zero}});
+  P[0][0].setOnes();
+  if( n == 0) return;
+  P[1][0] = z;
+  P[1][1].setOnes();
+  for( int k = 1; k < n; k++) {
+    P[k+1][0] = ((2*k + 1) * z * P[k][0] - k * P[k-1][0]) / (k + 1);
+    for( int j = 1; j < 3; j++) {
+      P[k+1][j] = P[k-1][j] + (2*k + 1) * P[k][j-1];
+    }
+  }
+}
+
+/**
+ *  faces(q, i) = sum over k <= i of products(k, q) * R(k, i).  Eigen's
+ *  triangular product is slow for long doubles; two running sums per dot
+ *  product keep the x87 adder busy and are over twice as fast.
+ */
+void combine(const Matrix &products, const Matrix &R, Matrix &faces) {
+  int num = products.rows(), n = products.cols();
+  faces.resize(n, num);
+  for( int q = 0; q < n; q++) {
+    const scalar *p = products.col(q).data();
+    for( int i = 0; i < num; i++) {
+      const scalar *r = R.col(i).data();
+      scalar s0 = 0, s1 = 0;
+      int k = 0;
+      for( ; k < i; k += 2) {
+        s0 += p[k] * r[k];
+        s1 += p[k + 1] * r[k + 1];
+      }
+      if( k == i) s0 += p[k] * r[k];
+      faces(q, i) = s0 + s1;
+    }
+  }
+}
+}
+
+BasisEvaluator::BasisEvaluator(int degree) :
+  _degree(degree), _dim(Degree::degreeToDim(degree))
+{
+  for( int i = 0; i < 3; i++) _functions.push_back({Function::Vertex, i, 0});
+  int face = 0;
+  for( int d = 1; d <= degree; d++) {
+    if( d >= 3) for( int r = 0; r < d-2; r++)
+      _functions.push_back({Function::Face, face++, 0});
+    if( d < degree) for( int e = 0; e < 3; e++)
+      _functions.push_back({Function::Edge, e, d});
+  }
+  assert((int) _functions.size() == _dim);
+
+  // the face functions in Cantor order of (r1, r2)
+  int numFaces = face;
+  _faceProducts.resize(numFaces);
+  for( int s = 0; s + 3 <= degree; s++) {
+    for( int r2 = 0; r2 <= s; r2++) {
+      _faceProducts[pairCantor(s - r2, r2)] = make_pair(s - r2, r2);
+    }
+  }
+  if( numFaces == 0) return;
+
+  // P_r1(L2-L1) P_r2(2L3-1) L1 L2 L3 is the bubble (r1, r2) plus bubbles of
+  // lower total degree, so Gram-Schmidt gives the same functions for both.
+  // Gram-Schmidt in the energy inner product is a QR decomposition of the
+  // gradients at the points of a quadrature rule, weighted by the roots of
+  // the weights.
+  auto rule = Quadrature::triangle(2 * (degree - 1));
+  Matrix grads(2 * rule.size(), numFaces);
+  vector<Jet> jets;
+  for( size_t q = 0; q < rule.size(); q++) {
+    faceProducts(rule[q].x, rule[q].y, numFaces, jets);
+    scalar sw = sqrt(rule[q].w);
+    for( int k = 0; k < numFaces; k++) {
+      grads(2*q, k) = sw * jets[k].x;
+      grads(2*q + 1, k) = sw * jets[k].y;
+    }
+  }
+
+  Eigen::HouseholderQR<Matrix> qr(grads);
+  Matrix R = qr.matrixQR().topRows(numFaces).triangularView<Eigen::Upper>();
+
+  // the leading coefficients of Gram-Schmidt are positive
+  for( int k = 0; k < numFaces; k++) {
+    if( R(k, k) < 0) R.row(k) *= -1;
+  }
+
+  _face = R.triangularView<Eigen::Upper>().solve(Matrix::Identity(numFaces, numFaces));
+}
+
+void BasisEvaluator::faceProducts(scalar x, scalar y, int num, vector<Jet> &out) const {
+  auto L = barycentric(x, y);
+  Jet bubble = L[0] * L[1] * L[2];
+  Jet t = L[1] + L[0] * -1;
+  Jet u = L[2] * 2 + linear(-1, 0, 0);
+
+  vector<array<scalar, 4>> Pt, Pu;
+  legendre(t.v, _degree, Pt);
+  legendre(u.v, _degree, Pu);
+
+  out.resize(num);
+  for( int k = 0; k < num; k++) {
+    int r1 = _faceProducts[k].first, r2 = _faceProducts[k].second;
+    out[k] = compose(Pt[r1], t) * compose(Pu[r2], u) * bubble;
+  }
+}
+
+void BasisEvaluator::evaluate(const TriType &tt, scalar x, scalar y, int dim, vector<Jet> &out) const {
+  assert(dim <= _dim);
+  auto L = barycentric(x, y);
+
+  // the face functions we need
+  int numFaces = 0;
+  for( int i = 0; i < dim; i++) {
+    if( _functions[i].kind == Function::Face) numFaces++;
+  }
+  vector<Jet> products;
+  if( numFaces > 0) faceProducts(x, y, numFaces, products);
+
+  // the integrated Legendre polynomials along each edge
+  array<vector<array<scalar, 4>>, 3> P;
+  array<Jet, 3> arg;
+  for( int e = 0; e < 3; e++) {
+    const Jet &Lj1 = L[e], &Lj2 = L[(e + 1) % 3];
+    arg[e] = (Lj2 + Lj1 * -1) * (tt.i(e) ? -1 : 1);
+    legendre(arg[e].v, _degree, P[e]);
+  }
+
+  out.resize(dim);
+  for( int i = 0; i < dim; i++) {
+    const Function &f = _functions[i];
+    switch( f.kind) {
+      case Function::Vertex:
+        out[i] = L[f.which];
+        break;
+      case Function::Edge: {
+        int e = f.which, d = f.d;
+        auto &p = P[e][d];
+        Jet E = compose({{p[1], p[2], p[3], 0}}, arg[e]) * (-8 * sqrt((scalar) 4*d + 2) / (d * (d + 1)));
+        out[i] = L[e] * L[(e + 1) % 3] * E;
+        break;
+      }
+      case Function::Face: {
+        Jet res = {0, 0, 0, 0, 0, 0};
+        for( int k = 0; k <= f.which; k++) {
+          res = res + products[k] * _face(k, f.which);
+        }
+        out[i] = res;
+        break;
+      }
+    }
+  }
+}
+
+void BasisEvaluator::evaluate(const TriType &tt, const Vector &x, const Vector &y, int dim,
+                              Matrix &values, Matrix *dx, Matrix *dy) const {
+  assert(dim <= _dim && x.rows() == y.rows());
+  assert((dx == nullptr) == (dy == nullptr));
+  int n = x.rows();
+  bool grads = dx != nullptr;
+  values.resize(n, dim);
+  if( grads) {
+    dx->resize(n, dim);
+    dy->resize(n, dim);
+  }
+
+  // the columns of many points do not stay in cache, so do blocks of them
+  const int block = 256;
+  if( n > block) {
+    Matrix v, vx, vy;
+    for( int q = 0; q < n; q += block) {
+      int m = min(block, n - q);
+      evaluate(tt, x.segment(q, m), y.segment(q, m), dim, v, grads ? &vx : nullptr, grads ? &vy : nullptr);
+      values.middleRows(q, m) = v;
+      if( grads) {
+        dx->middleRows(q, m) = vx;
+        dy->middleRows(q, m) = vy;
+      }
+    }
+    return;
+  }
+
+  // the barycentric coordinates and their (constant) gradients
+  array<Column, 3> L = {{1 - x.array() - y.array(), x.array(), y.array()}};
+  const scalar Lx[3] = {-1, 1, 0}, Ly[3] = {-1, 0, 1};
+
+  int numFaces = 0;
+  for( int i = 0; i < dim; i++) {
+    if( _functions[i].kind == Function::Face) numFaces++;
+  }
+
+  // the products P_r1(L2-L1) P_r2(2L3-1) L1 L2 L3, and from them the face
+  // functions, each a combination of the products before it
+  Matrix faces, facesx, facesy;
+  if( numFaces > 0) {
+    Column t = L[1] - L[0], u = 2*L[2] - 1;
+    const scalar tx = 2, ty = 1, ux = 0, uy = 2;
+    Column B = L[0] * L[1] * L[2];
+    Column Bx = Lx[0]*L[1]*L[2] + L[0]*Lx[1]*L[2] + L[0]*L[1]*Lx[2];
+    Column By = Ly[0]*L[1]*L[2] + L[0]*Ly[1]*L[2] + L[0]*L[1]*Ly[2];
+    vector<array<Column, 3>> Pt, Pu;
+    legendre(t, _degree, Pt);
+    legendre(u, _degree, Pu);
+
+    Matrix products(numFaces, n), productsx(numFaces, n), productsy(numFaces, n);
+    for( int k = 0; k < numFaces; k++) {
+      const Column &pt = Pt[_faceProducts[k].first][0], &dpt = Pt[_faceProducts[k].first][1];
+      const Column &pu = Pu[_faceProducts[k].second][0], &dpu = Pu[_faceProducts[k].second][1];
+      products.row(k) = (pt * pu * B).matrix().transpose();
+      if( !grads) continue;
+      productsx.row(k) = ((dpt*tx*pu + pt*dpu*ux) * B + pt * pu * Bx).matrix().transpose();
+      productsy.row(k) = ((dpt*ty*pu + pt*dpu*uy) * B + pt * pu * By).matrix().transpose();
+    }
+    combine(products, _face, faces);
+    if( grads) {
+      combine(productsx, _face, facesx);
+      combine(productsy, _face, facesy);
+    }
+  }
+
+  // the integrated Legendre polynomials along each edge, whose derivatives
+  // are the Legendre polynomials
+  array<vector<array<Column, 3>>, 3> P;
+  array<scalar, 3> argx, argy;
+  for( int e = 0; e < 3; e++) {
+    int e1 = (e + 1) % 3;
+    scalar sign = tt.i(e) ? -1 : 1;
+    argx[e] = sign * (Lx[e1] - Lx[e]);
+    argy[e] = sign * (Ly[e1] - Ly[e]);
+    legendre(sign * (L[e1] - L[e]), _degree, P[e]);
+  }
+
+  for( int i = 0; i < dim; i++) {
+    const Function &f = _functions[i];
+    switch( f.kind) {
+      case Function::Vertex:
+        values.col(i) = L[f.which].matrix();
+        if( grads) {
+          dx->col(i).setConstant(Lx[f.which]);
+          dy->col(i).setConstant(Ly[f.which]);
+        }
+        break;
+      case Function::Edge: {
+        int e = f.which, e1 = (e + 1) % 3, d = f.d;
+        scalar c = -8 * sqrt((scalar) 4*d + 2) / (d * (d + 1));
+        Column LL = L[e] * L[e1], E = c * P[e][d][1];
+        values.col(i) = (LL * E).matrix();
+        if( grads) {
+          Column dE = c * P[e][d][2];
+          dx->col(i) = ((Lx[e]*L[e1] + L[e]*Lx[e1]) * E + LL * dE * argx[e]).matrix();
+          dy->col(i) = ((Ly[e]*L[e1] + L[e]*Ly[e1]) * E + LL * dE * argy[e]).matrix();
+        }
+        break;
+      }
+      case Function::Face:
+        values.col(i) = faces.col(f.which);
+        if( grads) {
+          dx->col(i) = facesx.col(f.which);
+          dy->col(i) = facesy.col(f.which);
+        }
+        break;
+    }
+  }
+}
@@ -0,0 +1,74 @@
+#pragma once
+
+#include <vector>
+
+#include "matrix.h"
+#include "tritype.h"
+
+/**
+ *  Point evaluation of the hierarchical basis functions, with their first
+ *  and second derivatives, on the reference triangle (0,0), (1,0), (0,1).
+ *  The matrices in Basis are exact integrals of these functions as built in
+ *  Precomputations/hierarchicalbasis.h; this is for things that need point
+ *  values instead, like the residual estimator.
+ *
+ *  The basis consists of the three vertex functions, followed for
+ *  d = 1, ..., degree by the face functions of degree d and the edge
+ *  functions of degree d+1.  Edge functions are integrated Legendre
+ *  polynomials along the edge, reversed according to the tritype.  Face
+ *  functions are the bubbles (L2-L1)^r1 (2L3-1)^r2 L1 L2 L3, Gram-Schmidt
+ *  orthonormalized in the energy inner product.  We orthonormalize products
+ *  of Legendre polynomials spanning the same nested spaces instead, with a
+ *  QR decomposition, which gives the same functions far more stably.
+ */
+class BasisEvaluator {
+public:
+  // a value with its gradient and Hessian
+  struct Jet {
+    scalar v, x, y, xx, xy, yy;
+
+    Jet operator*(const Jet &o) const;
+    Jet operator*(scalar a) const { return {v*a, x*a, y*a, xx*a, xy*a, yy*a}; }
+    Jet operator+(const Jet &o) const;
+  };
+
+  BasisEvaluator(int degree);
+
+  int degree() const { return _degree; }
+  int dim() const { return _dim; }
+
+  /**
+   *  Evaluates the first `dim` basis functions of tritype `tt` at (x, y).
+   */
+  void evaluate(const TriType &tt, scalar x, scalar y, int dim, std::vector<Jet> &out) const;
+
+  /**
+   *  The same at many points at once, without second derivatives: row q of
+   *  `values`, `dx` and `dy` holds the first `dim` basis functions at
+   *  (x[q], y[q]).  The recurrences run on columns of points, in blocks that
+   *  stay in cache, and the face functions are combined from their Legendre
+   *  products with one dot product per point and function.  The gradients
+   *  are only computed if asked for; values alone are about 3.5 times as
+   *  fast per point as the above at degree 10, with gradients about 1.3.
+   */
+  void evaluate(const TriType &tt, const Vector &x, const Vector &y, int dim,
+                Matrix &values, Matrix *dx = nullptr, Matrix *dy = nullptr) const;
+
+  // what a basis function is: a vertex, edge or face function
+  struct Function {
+    enum Kind { Vertex, Edge, Face } kind;
+    int which;  // vertex or edge number, or face function number
+    int d;      // edge functions: the Legendre polynomial degree
+  };
+  const Function &function(int i) const { return _functions[i]; }
+
+private:
+  int _degree, _dim;
+  std::vector<Function> _functions;
+
+  // column k holds the coefficients of face function k in the products
+  std::vector<std::pair<int, int>> _faceProducts;
+  Matrix _face;
+
+  void faceProducts(scalar x, scalar y, int num, std::vector<Jet> &out) const;
+};
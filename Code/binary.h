@@ -0,0 +1,65 @@
+#pragma once
+
+#include <iostream>
+#include <string>
+#include <vector>
+
+#include "matrix.h"
+
+/**
+ *  Raw binary reading and writing of plain values, strings, vectors of plain
+ *  values and Eigen vectors, in the byte order and widths of this machine.
+ *  These are meant for files that are read back by the same build, like
+ *  checkpoints; a stream in a failed state simply reads zeroes.
+ */
+namespace Binary {
+
+template<class T>
+inline void write(std::ostream &os, const T &value) {
+  os.write((const char *) &value, sizeof(T));
+}
+
+template<class T>
+inline T read(std::istream &is) {
+  T value{};
+  is.read((char *) &value, sizeof(T));
+  return value;
+}
+
+inline void write(std::ostream &os, const std::string &s) {
+  write<long long>(os, s.size());
+  os.write(s.data(), s.size());
+}
+
+template<>
+inline std::string read<std::string>(std::istream &is) {
+  std::string s(read<long long>(is), '\0');
+  is.read(&s[0], s.size());
+  return s;
+}
+
+template<class T>
+inline void write(std::ostream &os, const std::vector<T> &v) {
+  write<long long>(os, v.size());
+  os.write((const char *) v.data(), v.size()*sizeof(T));
+}
+
+template<class T>
+inline std::vector<T> readVector(std::istream &is) {
+  std::vector<T> v(read<long long>(is));
+  is.read((char *) v.data(), v.size()*sizeof(T));
+  return v;
+}
+
+inline void write(std::ostream &os, const Vector &v) {
+  write<long long>(os, v.rows());
+  os.write((const char *) v.data(), v.rows()*sizeof(scalar));
+}
+
+inline Vector readVector(std::istream &is) {
+  Vector v(read<long long>(is));
+  is.read((char *) v.data(), v.rows()*sizeof(scalar));
+  return v;
+}
+
+}
@@ -0,0 +1,35 @@
+#include <fstream>
+#include <unistd.h>
+
+#include "budget.h"
+
+using namespace std;
+
+scalar Budget::seconds() const {
+  return chrono::duration<scalar>(chrono::steady_clock::now() - _start).count();
+}
+
+/**
+ *  The resident set size in MiB, from the second field of /proc/self/statm
+ *  (in pages); 0 where that is not available.
+ */
+scalar Budget::residentMemory() {
+  ifstream statm("/proc/self/statm");
+  long size, resident;
+  if( !(statm >> size >> resident)) return 0;
+  return (scalar) resident * sysconf(_SC_PAGESIZE) / (1024 * 1024);
+}
+
+bool Budget::exceeded(int numDOFs) {
+  if( hit()) return true;
+
+  if( maxDOFs > 0 && numDOFs > maxDOFs) {
+    _reason = "dofs " + to_string(numDOFs) + " > " + to_string(maxDOFs);
+  } else if( maxSeconds > 0 && seconds() > maxSeconds) {
+    _reason = "time " + to_string((double) seconds()) + "s > " + to_string((double) maxSeconds) + "s";
+  } else if( maxMemory > 0 && residentMemory() > maxMemory) {
+    _reason = "memory " + to_string((double) residentMemory()) + "MiB > " + to_string((double) maxMemory) + "MiB";
+  }
+
+  return hit();
+}
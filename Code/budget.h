@@ -0,0 +1,39 @@
+#pragma once
+
+#include <chrono>
+#include <string>
+
+#include "config.h"
+
+/**
+ *  Resource budgets for the AFEM drivers: a maximum number of DOFs, of
+ *  resident memory and of wall-clock time since construction.  A value of
+ *  0 means no limit.  The drivers call exceeded() at points where they can
+ *  stop with a usable solution; once a budget is exceeded, it stays so.
+ */
+class Budget {
+public:
+  Budget() : _start(std::chrono::steady_clock::now()) {}
+
+  int maxDOFs = 0;
+  scalar maxMemory = 0;    // in MiB
+  scalar maxSeconds = 0;
+
+  /**
+   *  Checks the budgets, the DOFs only if `numDOFs` is given.  If one is
+   *  exceeded, returns true and remembers which one in reason().
+   */
+  bool exceeded(int numDOFs = -1);
+  bool hit() const { return !_reason.empty(); }
+  const std::string &reason() const { return _reason; }
+
+  // caps a number of degrees of freedom, like NearBest's maxN, by maxDOFs
+  int cap(int N) const { return (maxDOFs > 0 && maxDOFs < N) ? maxDOFs : N; }
+
+  scalar seconds() const;
+  static scalar residentMemory();
+
+private:
+  std::chrono::steady_clock::time_point _start;
+  std::string _reason;
+};
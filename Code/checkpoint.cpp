@@ -0,0 +1,219 @@
+#include <cassert>
+#include <cstdio>
+#include <fstream>
+
+#include "checkpoint.h"
+#include "binary.h"
+
+using namespace std;
+
+namespace {
+const string magic = "hp-afem checkpoint";
+const int version = 1;
+
+long long indexOf(const Element *elt) {
+  return elt == nullptr ? -1 : elt->index();
+}
+
+void writeDofs(ostream &os, const ElementDofsMap &g) {
+  Binary::write<long long>(os, g.size());
+  for( auto &eg : g) {
+    Binary::write<long long>(os, eg.first->index());
+    Binary::write(os, eg.second.values());
+  }
+}
+
+ElementDofsMap readDofs(istream &is, Partition &partition) {
+  ElementDofsMap g;
+  long long n = Binary::read<long long>(is);
+  for( long long k = 0; k < n; k++) {
+    Element *elt = partition.element(Binary::read<long long>(is));
+    vector<int> values = Binary::readVector<int>(is);
+    Dofs dofs(values.size());
+    for( size_t i = 0; i < values.size(); i++) dofs.set(i, values[i]);
+    g.insert(g.end(), make_pair(elt, dofs));
+  }
+  return g;
+}
+}
+
+/**
+ *  The local vectors of a piecewise polynomial, where the lazy restrictions
+ *  are written as the index of their ancestor, so they stay lazy.
+ */
+void Checkpoint::writePolynomial(const PiecewisePolynomial &poly, ostream &os) {
+  Binary::write<long long>(os, poly.l2g.size());
+  for( auto &ev : poly.l2g) {
+    Binary::write<long long>(os, ev.first->index());
+    Binary::write(os, ev.second);
+  }
+  Binary::write<long long>(os, poly._lazy.size());
+  for( auto &ea : poly._lazy) {
+    Binary::write<long long>(os, ea.first->index());
+    Binary::write<long long>(os, ea.second->index());
+  }
+  vector<long long> definedOn;
+  for( Element *elt : poly._definedOn) definedOn.push_back(elt->index());
+  Binary::write(os, definedOn);
+}
+
+void Checkpoint::readPolynomial(PiecewisePolynomial &poly, Partition &partition, istream &is) {
+  long long n = Binary::read<long long>(is);
+  for( long long k = 0; k < n; k++) {
+    Element *elt = partition.element(Binary::read<long long>(is));
+    poly.l2g.insert(poly.l2g.end(), make_pair(elt, Binary::readVector(is)));
+    poly._availableOn.insert(elt);
+  }
+  n = Binary::read<long long>(is);
+  for( long long k = 0; k < n; k++) {
+    Element *elt = partition.element(Binary::read<long long>(is));
+    Element *ancestor = partition.element(Binary::read<long long>(is));
+    assert(poly.l2g.count(ancestor));
+    poly._lazy.insert(poly._lazy.end(), make_pair(elt, ancestor));
+    poly._availableOn.insert(elt);
+  }
+  for( long long i : Binary::readVector<long long>(is)) {
+    poly._definedOn.insert(partition.element(i));
+  }
+}
+
+void Checkpoint::write(Partition &p, ostream &os) {
+  Binary::write<int>(os, p._isConform);
+  Binary::write<int>(os, p._isMatching);
+  Binary::write<int>(os, p._isTriTypesCorrect);
+
+  Binary::write<long long>(os, p._verts.size());
+  for( Vertex *v : p._verts) {
+    Binary::write(os, v->x);
+    Binary::write(os, v->y);
+    Binary::write<char>(os, v->isBoundary());
+  }
+
+  Binary::write<long long>(os, p._elts.size());
+  for( Element *elt : p._elts) {
+    for( int i = 0; i < 3; i++) Binary::write<long long>(os, elt->i(i));
+    Binary::write<long long>(os, indexOf(elt->parent()));
+    Binary::write<long long>(os, indexOf(elt->left()));
+    Binary::write<long long>(os, indexOf(elt->right()));
+    Binary::write<int>(os, elt->type()._isset ? elt->type().toInt() : -1);
+    Binary::write<char>(os, p._roots.count(elt) > 0);
+    Binary::write<char>(os, elt->isLeaf());
+  }
+
+  Binary::write<int>(os, p._rhs.dof());
+  writePolynomial(p._rhs, os);
+
+  Binary::write<char>(os, p._handler.valid());
+  writeDofs(os, p._handler.map());
+
+  Binary::write(os, p._sol._global);
+  writeDofs(os, p._sol._g);
+  writePolynomial(p._sol, os);
+}
+
+void Checkpoint::read(Partition &p, istream &is) {
+  p._isConform = Binary::read<int>(is);
+  p._isMatching = Binary::read<int>(is);
+  p._isTriTypesCorrect = Binary::read<int>(is);
+
+  long long nVerts = Binary::read<long long>(is);
+  for( long long i = 0; i < nVerts; i++) {
+    scalar x = Binary::read<scalar>(is);
+    scalar y = Binary::read<scalar>(is);
+    Vertex *v = new Vertex(x, y);
+    v->_isBoundary = Binary::read<char>(is);
+    p.addVertex(v);
+  }
+
+  // the elements come in index order, so parents come before their children;
+  // the children are attached once all elements exist
+  long long nElts = Binary::read<long long>(is);
+  vector<pair<long long, long long>> children;
+  for( long long k = 0; k < nElts; k++) {
+    long long i[3];
+    for( int j = 0; j < 3; j++) i[j] = Binary::read<long long>(is);
+    long long parent = Binary::read<long long>(is);
+    long long left = Binary::read<long long>(is);
+    long long right = Binary::read<long long>(is);
+    int type = Binary::read<int>(is);
+    bool isRoot = Binary::read<char>(is);
+    bool isLeaf = Binary::read<char>(is);
+
+    Vertex *v[3] = {p._verts[i[0]], p._verts[i[1]], p._verts[i[2]]};
+    const Basis *basis = (type == -1) ? nullptr : &p._bases.basis(type);
+    Element *elt = new Element(v, parent == -1 ? nullptr : p.element(parent),
+                               nullptr, nullptr, basis);
+
+    // addElement() refuses roots after bisections, and elements that were
+    // roots before a resetRoots() are in the list but in no tree any more
+    elt->_index = p._elts.size();
+    p._elts.push_back(elt);
+    if( isRoot) {
+      p.addRoot(elt);
+      elt->_eltmats = new ElementMatrices(p._bases, elt);
+    }
+    elt->_isLeaf = isLeaf;
+    if( isLeaf) p._leaves.insert(elt);
+    children.push_back(make_pair(left, right));
+  }
+  for( long long k = 0; k < nElts; k++) {
+    Element *elt = p._elts[k];
+    if( children[k].first != -1) elt->_left = p.element(children[k].first);
+    if( children[k].second != -1) elt->_right = p.element(children[k].second);
+  }
+  p.rebuildElementFinder();
+
+  p._rhs = FEM::Rhs(Binary::read<int>(is));
+  readPolynomial(p._rhs, p, is);
+
+  bool valid = Binary::read<char>(is);
+  p._handler.assign(readDofs(is, p), valid);
+
+  p._sol = FEM::Solution();
+  p._sol._global = Binary::readVector(is);
+  p._sol._g = readDofs(is, p);
+  p._sol._rhs = p._rhs;
+  readPolynomial(p._sol, p, is);
+}
+
+void Checkpoint::save(Partition &partition, string filename) const {
+  string tmpfile = filename + ".tmp";
+  ofstream os(tmpfile, ios::out | ios::binary | ios::trunc);
+  assert(os.good());
+
+  Binary::write(os, magic);
+  Binary::write<int>(os, version);
+  Binary::write<int>(os, sizeof(scalar));
+  Binary::write(os, epsilon);
+  Binary::write(os, fineps);
+  Binary::write<int>(os, iteration);
+  write(partition, os);
+  os.close();
+
+  if( os.fail() || rename(tmpfile.c_str(), filename.c_str()) != 0) {
+    cerr << "Checkpoint: could not write " << filename << endl;
+    return;
+  }
+  cerr << "Checkpoint: saved iteration " << iteration << " to " << filename << endl;
+}
+
+unique_ptr<Partition> Checkpoint::load(string basisdir, string filename) {
+  ifstream is(filename, ios::in | ios::binary);
+  assert(is.good());
+
+  bool ours = Binary::read<string>(is) == magic && Binary::read<int>(is) == version
+           && Binary::read<int>(is) == sizeof(scalar);
+  assert(ours && "not a checkpoint of this version and scalar type");
+
+  epsilon = Binary::read<scalar>(is);
+  fineps = Binary::read<scalar>(is);
+  iteration = Binary::read<int>(is);
+
+  unique_ptr<Partition> partition(new Partition(std::move(basisdir)));
+  read(*partition, is);
+  assert(!is.fail() && "truncated checkpoint");
+
+  cerr << "Checkpoint: resumed iteration " << iteration << " from " << filename
+       << " with " << partition->leaves().size() << " leaves" << endl;
+  return partition;
+}
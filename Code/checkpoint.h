@@ -0,0 +1,47 @@
+#pragma once
+
+#include <iostream>
+#include <memory>
+#include <string>
+
+#include "partition.h"
+
+/**
+ *  Checkpoint.h
+ *
+ *  A binary snapshot of a partition and of the counters of the driver that
+ *  works on it, from which that driver can resume without redoing the
+ *  refinements.  It holds, in order:
+ *  - the vertices, with their boundary flags;
+ *  - all elements ever created, in index order, with their vertices,
+ *    parent, children, tritype and whether they are a root or a leaf; this
+ *    includes trimmed subtrees, so that bisections reuse them as before;
+ *  - the local vectors of the right-hand side on every element it has;
+ *  - the DOFHandler numbering, and the global vector of the solution.
+ *
+ *  Local vectors are stored as computed, so that a resumed run continues
+ *  with bitwise the same numbers.  The bases are not stored; a checkpoint
+ *  has to be loaded with the bases directory it was made with.
+ */
+class Checkpoint {
+public:
+  // the state of the driver
+  scalar epsilon = 0, fineps = 0;
+  int iteration = 0;
+
+  /**
+   *  Writes `partition` and the driver state to `filename`.  It is first
+   *  written to a temporary file, so that a run dying halfway through does
+   *  not destroy an earlier checkpoint.
+   */
+  void save(Partition &partition, std::string filename) const;
+
+  // reads the driver state into this, and returns the partition
+  std::unique_ptr<Partition> load(std::string basisdir, std::string filename);
+
+private:
+  static void write(Partition &partition, std::ostream &os);
+  static void read(Partition &partition, std::istream &is);
+  static void writePolynomial(const PiecewisePolynomial &poly, std::ostream &os);
+  static void readPolynomial(PiecewisePolynomial &poly, Partition &partition, std::istream &is);
+};
@@ -79,7 +79,10 @@ void DOFHandler::determine(const ElementSet &elts, int dof) {
 }
 
 void DOFHandler::determine(ElementDimsSet &eltdims) {
+  assert(!_journaling && "renumbering everything cannot be rolled back");
+
   // reset everything
+  _revision++;
   _numDOFs = 0;
   _vec.clear();
   _g.clear();
@@ -163,17 +166,34 @@ void DOFHandler::determine(ElementDimsSet &eltdims) {
   _valid = true;
 }
 
+void DOFHandler::assign(const ElementDofsMap &g, bool valid) {
+  assert(!_journaling);
+  _revision++;
+  _g = g;
+  _vec.clear();
+  _numDOFs = 0;
+  for (const auto &eg : _g) {
+    for (int i = 0; i < 3; i++) {
+      _vec[eg.first->v(i)] = eg.second.getVertex(i);
+    }
+    for (int gi : eg.second.values()) {
+      _numDOFs = max(_numDOFs, gi + 1);
+    }
+  }
+  _valid = valid;
+}
+
 void DOFHandler::set(Element *elt, int dim) {
   Dofs g;
   g.reset(dim);
-  _g[elt] = g;
+  store(elt, g);
   _valid = false;
 }
 
 void DOFHandler::reset(Element *elt, int dim) {
   Dofs g = find(elt);
   g.reset(dim); 
-  _g[elt] = g;
+  store(elt, g);
   _valid = false;
 }
 
@@ -181,19 +201,18 @@ void DOFHandler::construct(Element *elt, int dim) {
   assert(_g.count(elt) == 0);
   Dofs g;
   g.reset(dim);
-  _g[elt] = g;
+  store(elt, g);
 }
 
 void DOFHandler::erase(Element *elt) {
-  auto it = _g.find(elt);
-  assert(it != _g.end());
-  _g.erase(it);
+  assert(_g.count(elt) > 0);
+  remove(elt);
   _valid = 0;
 }
 
 void DOFHandler::transferToChildren(Element *parent) {
   copyToChildren(parent);
-  _g.erase(parent);
+  remove(parent);
 }
 
 void DOFHandler::copyToChildren(Element *parent) {
@@ -211,21 +230,21 @@ void DOFHandler::copyToChildren(Element *parent) {
 
   // If newest vertex is not on boundary, assign it a DOF.
   if (_vec.find(left->v(0)) == _vec.end()) {
-    _vec[left->v(0)] = -1;
+    storeVertex(left->v(0), -1);
   }
   if (!left->v(0)->isBoundary()) {
-    if (_vec[left->v(0)] == -1) {
-      _vec[left->v(0)] = increaseNumDOFs();
+    if (find(left->v(0)) == -1) {
+      storeVertex(left->v(0), increaseNumDOFs());
     }
-    leftg.setVertex(0, _vec[left->v(0)]);
-    rightg.setVertex(0, _vec[left->v(0)]);
+    leftg.setVertex(0, find(left->v(0)));
+    rightg.setVertex(0, find(left->v(0)));
   }
 
   // Copy vertex DOFs from parent.
-  leftg.setVertex(1, _vec[left->v(1)]); 
-  rightg.setVertex(1, _vec[right->v(1)]);
-  leftg.setVertex(2, _vec[left->v(2)]);
-  rightg.setVertex(2, _vec[right->v(2)]);
+  leftg.setVertex(1, find(left->v(1))); 
+  rightg.setVertex(1, find(right->v(1)));
+  leftg.setVertex(2, find(left->v(2)));
+  rightg.setVertex(2, find(right->v(2)));
 
   // Find neighbour along bisection edge.
   auto nbrEdge = finder.elementOppositeBisectionEdge(parent);
@@ -292,8 +311,8 @@ void DOFHandler::copyToChildren(Element *parent) {
           }
         }
 
-        _g[nbr->left()] = nbrleftg;
-        _g[nbr->right()] = nbrrightg;
+        store(nbr->left(), nbrleftg);
+        store(nbr->right(), nbrrightg);
 
         // TODO: why is this commented out?
         /*
@@ -310,8 +329,8 @@ void DOFHandler::copyToChildren(Element *parent) {
     }
   }
 
-  _g[left] = leftg;
-  _g[right] = rightg;
+  store(left, leftg);
+  store(right, rightg);
 
   _valid = true;
 }
@@ -390,13 +409,82 @@ void DOFHandler::increaseBy(Element *parent, int dof) {
           nbrg.setEdge(k-1, nbrEdge.second, g.getEdge(k-1, leafEdge.second));
 
           // Update the DOFs again.
-          _g[nbr] = nbrg;
+          store(nbr, nbrg);
         }
       }
     }
   }
 
-  _g[parent] = g;
+  store(parent, g);
+}
+
+void DOFHandler::store(Element *elt, const Dofs &g) {
+  if (_journaling && _journal.g.count(elt) == 0) {
+    auto it = _g.find(elt);
+    _journal.g[elt] = it == _g.end() ? make_pair(false, Dofs()) : make_pair(true, it->second);
+  }
+  _revision++;
+  _g[elt] = g;
+}
+
+void DOFHandler::remove(Element *elt) {
+  auto it = _g.find(elt);
+  if (it == _g.end()) return;
+  if (_journaling && _journal.g.count(elt) == 0) _journal.g[elt] = make_pair(true, it->second);
+  _revision++;
+  _g.erase(it);
+}
+
+void DOFHandler::storeVertex(Vertex *v, int dof) {
+  if (_journaling && _journal.vec.count(v) == 0) {
+    auto it = _vec.find(v);
+    _journal.vec[v] = it == _vec.end() ? make_pair(false, -1) : make_pair(true, it->second);
+  }
+  _revision++;
+  _vec[v] = dof;
+}
+
+void DOFHandler::beginJournal() {
+  assert(!_journaling);
+  _journaling = true;
+  _journal.g.clear();
+  _journal.vec.clear();
+  _journal.numDOFs = _numDOFs;
+  _journal.valid = _valid;
+}
+
+void DOFHandler::commitJournal() {
+  assert(_journaling);
+  _journaling = false;
+  _journal.g.clear();
+  _journal.vec.clear();
+}
+
+/**
+ *  Puts back the first recorded value of every entry changed since
+ *  beginJournal(), or removes it if it was not there.  The new DOFs are
+ *  numbered from _numDOFs on, so resetting it returns their numbers.
+ */
+void DOFHandler::rollbackJournal() {
+  assert(_journaling);
+  _revision++;
+  for (auto &eg : _journal.g) {
+    if (eg.second.first) {
+      _g[eg.first] = eg.second.second;
+    } else {
+      _g.erase(eg.first);
+    }
+  }
+  for (auto &vd : _journal.vec) {
+    if (vd.second.first) {
+      _vec[vd.first] = vd.second.second;
+    } else {
+      _vec.erase(vd.first);
+    }
+  }
+  _numDOFs = _journal.numDOFs;
+  _valid = _journal.valid;
+  commitJournal();
 }
 
 bool DOFHandler::has(Element *elt) {
@@ -416,16 +504,16 @@ int DOFHandler::find(Vertex *v) {
 }
 
 ostream &DOFHandler::print( ostream &os) {
-  os << Print::formatted("%lu", _g.size()) << endl;
+  Formatter f(os);
+  f << _g.size() << '\n';
   for (const auto &ed : _g) {
     Element *elt = ed.first;
-    Dofs g = ed.second;
-    os << Print::formatted("%lu %d %d %d %d", g.dim(), elt->i(0), elt->i(1),
-                           elt->i(2), elt->type().toInt());
+    const Dofs &g = ed.second;
+    f << g.dim() << ' ' << elt->i(0) << ' ' << elt->i(1) << ' ' << elt->i(2) << ' ' << elt->type().toInt();
     for (const auto gi : g.values()) {
-      os << " " << gi;
+      f << ' ' << gi;
     }
-    os << endl;
+    f << '\n';
   }
 
   return os;
@@ -18,6 +18,10 @@ public:
   const ElementDofsMap &map() const { return _g; }
 
   bool valid() { return _valid; }
+
+  // changes whenever an element or vertex entry changes, so that results
+  // computed from this numbering can tell they are stale
+  unsigned long revision() const { return _revision; }
   int recomputeNumDOFs();
   int maxDegree();
 
@@ -34,6 +38,9 @@ public:
   void determine(ElementDimsSet &eltdims);
   void redetermine();
   void redetermineOn(const ElementSet &elts);
+
+  // takes over a numbering determined earlier, e.g. read from a checkpoint
+  void assign(const ElementDofsMap &g, bool valid = true);
   void transferToChildren(Element *parent);
 
   void increaseBy(Element *parent, int dof);
@@ -45,13 +52,39 @@ public:
 
   std::ostream &print(std::ostream &os = std::cout);
 
+  /**
+   *  Between beginJournal() and rollbackJournal(), the previous value of
+   *  every element and vertex entry changed is recorded, so that a rollback
+   *  restores the handler in time proportional to the changes.  Renumbering
+   *  everything with determine() or assign() is not allowed meanwhile.
+   */
+  void beginJournal();
+  void commitJournal();
+  void rollbackJournal();
+  bool journaling() const { return _journaling; }
+
 protected:
   ElementFinder &finder;
   ElementDofsMap _g;
   std::map<Vertex *, int> _vec;
   bool _valid;
+  unsigned long _revision = 0;
 
   int _numDOFs;
   int increaseNumDOFs() { _numDOFs++; return _numDOFs-1; }
   void copyToChildren(Element *parent);
+
+  // the entries as they were before the journal changed them; false if absent
+  struct Journal {
+    std::map<Element *, std::pair<bool, Dofs>> g;
+    std::map<Vertex *, std::pair<bool, int>> vec;
+    int numDOFs;
+    bool valid;
+  };
+  bool _journaling = false;
+  Journal _journal;
+
+  void store(Element *elt, const Dofs &g);
+  void remove(Element *elt);
+  void storeVertex(Vertex *v, int dof);
 };
@@ -24,7 +24,7 @@ const TriClass &Element::triclass() {
   return _tc = TriClass(0);
 }
 
-Matrix Element::elementMatrix( int dof) {
+Eigen::Block<const Matrix> Element::elementMatrix( int dof) {
   int curdim = Degree::dofToDim(dof);
   return _eltmats->get(type(), triclass()).topLeftCorner(curdim, curdim);
 }
@@ -51,6 +51,11 @@ Matrix Element::transferMatrix( bool rightChild, int dof) {
   return basis()->transfermat((int)rightChild).topLeftCorner(curdim, curdim);
 }
 
+Vector Element::transfer( unsigned path, int generations, const Vector &v) {
+  assert(_eltmats != nullptr);
+  return _eltmats->bases().transfer(type(), path, generations, v);
+}
+
 Element::Element(Vertex *v[3], Element *parent, Element *left, Element *right, const Basis *basis) : 
   Triangle(v, parent ? parent->vol()/2 : -1.0), 
   Node(parent, left, right),
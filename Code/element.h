@@ -26,6 +26,7 @@ class Approximator;
 class Partition;
 class Matchable;
 class NearBest;
+class Checkpoint;
 
 class Element : public Triangle, public Node {
   public:
@@ -47,10 +48,11 @@ class Element : public Triangle, public Node {
     Edge bisectionEdge() { return Edge(_v[1], _v[2]); }
 
     /* Element matrix & vector routines */
-    Matrix elementMatrix( int dof);
+    Eigen::Block<const Matrix> elementMatrix( int dof);
     ElementMatrix massMatrix( int dof, int dof2 = -1);
     ElementVector elementVector( int dof);
     Matrix transferMatrix( bool rightChild, int dof);
+    Vector transfer( unsigned path, int generations, const Vector &v);
 
     Element(Vertex *v[3], Element *parent, Element *left, Element *right, const Basis *basis);
     Element(Vertex *v[3], Element *parent, Element *left, Element *right);
@@ -65,6 +67,7 @@ class Element : public Triangle, public Node {
     friend class Partition;
     friend class Matchable;
     friend class NearBest;
+    friend class Checkpoint;
 
   protected:
     const static int _childclass[4][2];
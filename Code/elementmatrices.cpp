@@ -5,9 +5,12 @@
 
 using namespace std;
 
-Matrix &ElementMatrices::get(int tt, int tc) {
-  if( _eltmats[tt][tc].rows() > 0) return _eltmats[tt][tc];
+const Matrix &ElementMatrices::get(int tt, int tc) {
+  std::call_once(_computed[tt][tc], [&] { compute(tt, tc); });
+  return _eltmats[tt][tc];
+}
 
+void ElementMatrices::compute(int tt, int tc) {
   Element *elt = _root;
   if( tc == 1) elt = _root->left();
   if( tc == 2) elt = _root->right();
@@ -26,6 +29,5 @@ Matrix &ElementMatrices::get(int tt, int tc) {
                    _bases.basis(tt).eltmat(1)*E1 +
                    _bases.basis(tt).eltmat(2)*E2)/D;
 
-  Vector v = Vector::Random(eltmat.rows());
-  return _eltmats[tt][tc] = eltmat;
+  _eltmats[tt][tc] = eltmat;
 }
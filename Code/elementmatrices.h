@@ -1,4 +1,5 @@
 #pragma once
+#include <mutex>
 
 #include "basis.h"
 #include "matrix.h"
@@ -9,8 +10,13 @@ class ElementMatrices {
   Bases &_bases;
   Element *_root;
   Matrix _eltmats[8][4];
+  std::once_flag _computed[8][4];
+
+  void compute(int tt, int tc);
 public:
   ElementMatrices(Bases &bases, Element *root) : _bases(bases), _root(root) {}
-  Matrix &get(int tt, int tc);
+  // safe to call concurrently; each matrix is computed once
+  const Matrix &get(int tt, int tc);
+  const Bases &bases() const { return _bases; }
   virtual ~ElementMatrices() = default;
 };
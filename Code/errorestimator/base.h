@@ -16,9 +16,8 @@ protected:
 public:
   virtual Errors sqerrors() { return _sqerrors; }
   virtual scalar error() {
-    auto scalarset = _sqerrors.on(partition.roots());
     scalar ret = 0;
-    for(auto const p : scalarset) ret += p.second;
+    for(auto root : partition.roots()) ret += _sqerrors.on(root);
     return std::sqrt(ret);
   }
 };
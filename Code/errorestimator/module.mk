@@ -1,2 +1,5 @@
 LIBS += -lginac -lcln
-SRCS += 
+SRCS += errorestimator/residual.cpp
+SRCS += errorestimator/patch.cpp
+SRCS += errorestimator/refine.cpp
+SRCS += errorestimator/surplus.cpp
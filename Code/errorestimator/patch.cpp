@@ -0,0 +1,180 @@
+#include <algorithm>
+#include <map>
+#include <vector>
+#include <Eigen/Cholesky>
+
+#include "patch.h"
+#include "../basisevaluator.h"
+#include "../elementfinder.h"
+
+using namespace std;
+
+namespace {
+
+// an element of the patch of vertex z
+struct PatchElement {
+  Element *elt;
+  int vertex;               // local index of z in elt
+  bool shared[3];           // whether the edges have a neighbour
+  const Vector *u, *f;
+};
+
+struct VertexPatch {
+  Vertex *z;
+  vector<PatchElement> elts;
+  vector<scalar> energies;  // of e_z on each of elts
+};
+
+void solve(VertexPatch &patch, const BasisEvaluator &evaluator) {
+  typedef BasisEvaluator::Function Function;
+
+  // the degree of the local space
+  int q = 0;
+  for( auto &pe : patch.elts) {
+    q = max(q, Degree::dofToDegree(pe.u->rows()) + 1);
+  }
+  q = min(q, evaluator.degree());
+  int dim = Degree::degreeToDim(q);
+  int numFaces = (q - 1)*(q - 2)/2;
+
+  // the vertex function of z lives if z is not on the boundary, and the
+  // edge functions live on the edges through z inside the domain
+  bool zInside = true;
+  for( auto &pe : patch.elts) {
+    int m = pe.vertex, prev = (m + 2) % 3;
+    if( !pe.shared[m] || !pe.shared[prev]) zInside = false;
+  }
+
+  int n = 0;
+  int zdof = zInside ? n++ : -1;
+  map<Vertex *, int> edgeDofs;
+  for( auto &pe : patch.elts) {
+    for( int e : {pe.vertex, (pe.vertex + 2) % 3}) {
+      if( !pe.shared[e]) continue;
+      Vertex *w = pe.elt->v(e == pe.vertex ? (e + 1) % 3 : e);
+      if( edgeDofs.count(w) == 0) {
+        edgeDofs[w] = n;
+        n += q - 1;
+      }
+    }
+  }
+
+  // local basis function i of element k maps to unknown dofs[k][i], or is
+  // zero in the local space if that is -1
+  vector<vector<int>> dofs(patch.elts.size(), vector<int>(dim, -1));
+  for( size_t k = 0; k < patch.elts.size(); k++) {
+    auto &pe = patch.elts[k];
+    int m = pe.vertex, faces = n;
+    n += numFaces;
+    for( int i = 0; i < dim; i++) {
+      const Function &f = evaluator.function(i);
+      switch( f.kind) {
+        case Function::Vertex:
+          if( f.which == m) dofs[k][i] = zdof;
+          break;
+        case Function::Edge:
+          if( (f.which == m || (f.which + 1) % 3 == m) && pe.shared[f.which]) {
+            Vertex *w = pe.elt->v(f.which == m ? (m + 1) % 3 : f.which);
+            dofs[k][i] = edgeDofs[w] + f.d - 1;
+          }
+          break;
+        case Function::Face:
+          dofs[k][i] = faces + f.which;
+          break;
+      }
+    }
+  }
+
+  // assemble a(e, v) = (f, v) - a(u_h, v)
+  Matrix A = Matrix::Zero(n, n);
+  Vector b = Vector::Zero(n);
+  vector<Matrix> eltmats;
+  for( size_t k = 0; k < patch.elts.size(); k++) {
+    auto &pe = patch.elts[k];
+    const Vector &u = *pe.u, &f = *pe.f;
+    eltmats.push_back(pe.elt->elementMatrix(dim));
+    const Matrix &eltmat = eltmats.back();
+
+    int fdim = min((int) f.rows(), dim);
+    Vector r = pe.elt->massMatrix(dim, fdim) * f.head(fdim)
+             - eltmat.leftCols(u.rows()) * u;
+
+    for( int i = 0; i < dim; i++) {
+      int I = dofs[k][i];
+      if( I == -1) continue;
+      b[I] += r[i];
+      for( int j = 0; j < dim; j++) {
+        int J = dofs[k][j];
+        if( J != -1) A(I, J) += eltmat(i, j);
+      }
+    }
+  }
+
+  Vector e = A.ldlt().solve(b);
+
+  patch.energies.resize(patch.elts.size());
+  for( size_t k = 0; k < patch.elts.size(); k++) {
+    Vector local = Vector::Zero(dim);
+    for( int i = 0; i < dim; i++) {
+      if( dofs[k][i] != -1) local[i] = e[dofs[k][i]];
+    }
+    patch.energies[k] = local.dot(eltmats[k] * local);
+  }
+}
+}
+
+namespace ErrorEstimator {
+
+Patch::Patch(Partition &partition, const FEM::Solution &sol)
+  : ErrorEstimator::Base(partition, sol)
+{
+  const BasisEvaluator &evaluator = partition.bases().evaluator();
+  FEM::Rhs &rhs = partition.rhs();
+  ElementFinder finder(partition.leaves());
+
+  // gather the patches; this materializes lazy restrictions, and computes
+  // the triclasses that elementMatrix() needs, so it is done serially
+  vector<VertexPatch> patches;
+  map<Vertex *, size_t> patchOf;
+  for( Element *elt : partition.leaves()) {
+    elt->triclass();
+    PatchElement pe;
+    pe.elt = elt;
+    pe.u = &sol.locallyAt(elt);
+    pe.f = &rhs.locallyAt(elt);
+    auto edges = elt->edges();
+    for( int i = 0; i < 3; i++) {
+      pe.shared[i] = finder.elementOppositeEdge(edges[i]).first != nullptr;
+    }
+
+    for( int m = 0; m < 3; m++) {
+      Vertex *z = elt->v(m);
+      auto it = patchOf.find(z);
+      if( it == patchOf.end()) {
+        it = patchOf.insert(make_pair(z, patches.size())).first;
+        patches.push_back(VertexPatch());
+        patches.back().z = z;
+      }
+      pe.vertex = m;
+      patches[it->second].elts.push_back(pe);
+    }
+  }
+
+  // the patch problems are independent
+#pragma omp parallel for schedule(dynamic)
+  for( size_t k = 0; k < patches.size(); k++) {
+    solve(patches[k], evaluator);
+  }
+
+  // every element is in three patches
+  map<Element *, scalar, TriangleSetCompare> sqerrors;
+  for( auto &patch : patches) {
+    for( size_t k = 0; k < patch.elts.size(); k++) {
+      sqerrors[patch.elts[k].elt] += patch.energies[k] / 3;
+    }
+  }
+
+  _sqerrors = Errors(ElementScalarSet(sqerrors.begin(), sqerrors.end()));
+}
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "base.h"
+
+/**
+ *  Patch.h
+ *
+ *  An error estimator that solves a small problem on every vertex patch of
+ *  the leaves: on the patch of a vertex z, it finds e_z in the continuous
+ *  piecewise polynomials of degree p+1 (p the maximum degree on the patch)
+ *  that vanish on the boundary of the patch and of the domain, such that
+ *
+ *    a(e_z, v) = (f, v) - a(u_h, v)   for all such v.
+ *
+ *  Every element lies in three patches, so its squared error is the average
+ *  of the energies of the three e_z on it.  This is a local version of
+ *  Refine: it uses the same kind of richer space, but only on patches, which
+ *  are independent and solved concurrently.
+ */
+
+namespace ErrorEstimator {
+class Patch : public Base {
+public:
+  Patch(Partition &partition, const FEM::Solution &sol);
+};
+}
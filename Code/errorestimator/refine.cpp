@@ -0,0 +1,79 @@
+#include "refine.h"
+
+using namespace std;
+
+namespace ErrorEstimator {
+
+namespace {
+// the local vectors of sol on the leaves, in leaf order
+vector<Vector> valuesOn(Partition &partition, const FEM::Solution &sol) {
+  vector<Vector> values;
+  for( auto &elt : partition.leaves()) {
+    values.push_back(sol.has(elt) ? sol.locallyAt(elt) : Vector());
+  }
+  return values;
+}
+
+bool sameValues(const vector<Vector> &a, const vector<Vector> &b) {
+  if( a.size() != b.size()) return false;
+  for( size_t i = 0; i < a.size(); i++) {
+    if( a[i].rows() != b[i].rows() || a[i] != b[i]) return false;
+  }
+  return true;
+}
+}
+
+Refine::Refine(Partition &partition, const FEM::Solution &sol, int h, int p)
+  : ErrorEstimator::Base(partition, sol)
+{
+  Partition::RefineEstimate &last = partition.lastRefineEstimate();
+  vector<Vector> values = valuesOn(partition, sol);
+  if( last.h == h && last.p == p && last.revision == partition.revision() &&
+      last.dofRevision == partition.handler().revision() && sameValues(last.values, values)) {
+    cerr << "Refine: nothing changed since the last call, reusing its errors" << endl;
+    _sqerrors = last.sqerrors;
+  } else {
+    estimate(h, p);
+
+    // estimating refines and rolls back, which counts as a change of the tree
+    last.h = h;
+    last.p = p;
+    last.revision = partition.revision();
+    last.dofRevision = partition.handler().revision();
+    last.values = std::move(values);
+    last.sqerrors = _sqerrors;
+  }
+
+  partition.printElementScalarSet(_sqerrors.on(partition.leaves()),
+                                  "output/errors_" + std::to_string(partition.handler().recomputeNumDOFs()) + "_" 
+                                                   + std::to_string(error()) + ".error");
+}
+
+void Refine::estimate(int h, int p) {
+  // make local copies of the DOFHandler and current solution
+  DOFHandler curhandler = partition.handler();
+  FEM::Solution cursol = sol;
+
+  // record the refinements below, so that we can undo them later
+  ElementSet leaves = partition.leaves();
+  partition.beginTransaction();
+
+  // do some p-refinements
+  if( p > 0) curhandler.increaseDegreeBy(leaves, p);
+
+  // do some h-refinements
+  for( int i = 0; i < h; i++) {
+    partition.refineLeavesUniformly(curhandler);
+  }
+
+  // solve the system on this refined partition
+  FEM::Solution exact = FEM::Solver(curhandler, partition.rhs()).sol();
+
+  // get the (squared) errors
+  _sqerrors = Errors(cursol.squaredH1NormsOfDifferenceWith(exact));
+
+  // get the partition back in its original state
+  partition.rollbackTransaction();
+}
+
+}
@@ -1,3 +1,4 @@
+#pragma once
 #include "base.h"
 #include "../fem/solver.h"
 #include "../dofhandler.h"
@@ -16,6 +17,13 @@
  *  the number of times we will multiply the number of leaves with four.
  *  p is the input of increaseDegreeBy(), i.e., the number of degrees we will 
  *  add to the elements.
+ *
+ *  The fine solve is by far the most expensive part, and it is often asked
+ *  for the same mesh and solution twice in a row (e.g., the last estimate of
+ *  Reduce and the next prestart error).  So the partition keeps the errors
+ *  of the last call with the revisions of its tree and DOFHandler and the
+ *  solution on its leaves, and those errors are returned if none of them
+ *  changed.  The right-hand side on the leaves only changes with the tree.
  */
 
 namespace ErrorEstimator {
@@ -23,36 +31,9 @@ class Refine : public Base {
 public:
   Refine(Partition &partition, const FEM::Solution &sol)
     : Refine(partition, sol, 2, 0) {}
-  Refine(Partition &partition, const FEM::Solution &sol, int h, int p)
-    : ErrorEstimator::Base(partition, sol)
-  {
-    // make local copies of the DOFHandler and current solution
-    DOFHandler curhandler = partition.handler();
-    FEM::Solution cursol = sol;
-
-    // make local copy of the current leaves so that we can restore later
-    ElementSet leaves = partition.leaves();
-
-    // do some p-refinements
-    if( p > 0) curhandler.increaseDegreeBy(leaves, p);
-
-    // do some h-refinements
-    for( int i = 0; i < h; i++) {
-      partition.refineLeavesUniformly(curhandler);
-    }
-
-    // solve the system on this refined partition
-    FEM::Solution exact = FEM::Solver(curhandler, partition.rhs()).sol();
-
-    // get the (squared) errors
-    _sqerrors = Errors(cursol.squaredH1NormsOfDifferenceWith(exact));
-
-    partition.printElementScalarSet(_sqerrors.on(leaves),
-                                    "output/errors_" + std::to_string(partition.handler().recomputeNumDOFs()) + "_" 
-                                                     + std::to_string(error()) + ".error");
+  Refine(Partition &partition, const FEM::Solution &sol, int h, int p);
 
-    // get the partition back in its original state, at least leaves-wise
-    for( auto &elt: leaves) partition.trim(elt);
-  }
+private:
+  void estimate(int h, int p);
 };
 }
@@ -0,0 +1,230 @@
+#include <array>
+#include <cmath>
+#include <map>
+#include <tuple>
+#include <vector>
+
+#include "residual.h"
+#include "../basisevaluator.h"
+#include "../elementfinder.h"
+#include "../quadrature.h"
+
+using namespace std;
+
+namespace {
+typedef BasisEvaluator::Jet Jet;
+
+// the vertices of the reference triangle
+const scalar refx[3] = {0, 1, 0}, refy[3] = {0, 0, 1};
+
+// basis functions evaluated at the points of a quadrature rule
+struct Table {
+  vector<Quadrature::Point> rule;
+  vector<vector<Jet>> jets;
+};
+
+// (tritype, dim, rule degree) for the interior, and with the edge for edges
+typedef tuple<int, int, int> InteriorKey;
+typedef tuple<int, int, int, int> EdgeKey;
+
+// everything we need to know about a leaf to compute its indicator
+struct Local {
+  Element *elt;
+  const Vector *u, *f;
+  int p;
+  array<Element *, 3> nbr;
+  array<const Vector *, 3> nbru;
+  array<int, 3> nbrEdge, nbrp;
+  const Table *interior;
+  array<const Table *, 3> edge, nbrEdgeTable;
+};
+
+// the gradient of a function on the physical element, from its gradient on
+// the reference element; Jinvt is the inverse transpose of the Jacobian
+inline void physicalGradient(const scalar Jinvt[2][2], scalar gx, scalar gy,
+                             scalar &x, scalar &y) {
+  x = Jinvt[0][0]*gx + Jinvt[0][1]*gy;
+  y = Jinvt[1][0]*gx + Jinvt[1][1]*gy;
+}
+
+void inverseTransposedJacobian(Element *elt, scalar Jinvt[2][2]) {
+  scalar J00 = elt->v(1)->x - elt->v(0)->x, J01 = elt->v(2)->x - elt->v(0)->x,
+         J10 = elt->v(1)->y - elt->v(0)->y, J11 = elt->v(2)->y - elt->v(0)->y;
+  scalar det = J00*J11 - J01*J10;
+  Jinvt[0][0] =  J11/det; Jinvt[0][1] = -J10/det;
+  Jinvt[1][0] = -J01/det; Jinvt[1][1] =  J00/det;
+}
+
+scalar length(Vertex *a, Vertex *b) {
+  return sqrt((b->x - a->x)*(b->x - a->x) + (b->y - a->y)*(b->y - a->y));
+}
+
+scalar indicator(const Local &l) {
+  Element *elt = l.elt;
+  const Vector &u = *l.u, &f = *l.f;
+  scalar Jinvt[2][2];
+  inverseTransposedJacobian(elt, Jinvt);
+
+  // G = J^{-1} J^{-T} turns reference second derivatives into the Laplacian
+  scalar G00 = Jinvt[0][0]*Jinvt[0][0] + Jinvt[1][0]*Jinvt[1][0],
+         G01 = Jinvt[0][0]*Jinvt[0][1] + Jinvt[1][0]*Jinvt[1][1],
+         G11 = Jinvt[0][1]*Jinvt[0][1] + Jinvt[1][1]*Jinvt[1][1];
+
+  // the element residual f + Laplace u
+  scalar residual = 0;
+  const Table &interior = *l.interior;
+  for( size_t q = 0; q < interior.rule.size(); q++) {
+    auto &jets = interior.jets[q];
+    scalar val = 0;
+    for( int i = 0; i < f.rows(); i++) val += f[i] * jets[i].v;
+    for( int i = 0; i < u.rows(); i++) {
+      val += u[i] * (G00*jets[i].xx + 2*G01*jets[i].xy + G11*jets[i].yy);
+    }
+    residual += interior.rule[q].w * val * val;
+  }
+  residual *= 2 * elt->vol();
+
+  scalar h = 0;
+  for( int i = 0; i < 3; i++) h = max(h, length(elt->v(i), elt->v((i+1) % 3)));
+  scalar res = (h/l.p) * (h/l.p) * residual;
+
+  // the jumps of the normal derivative over the interior edges
+  for( int i = 0; i < 3; i++) {
+    Element *nbr = l.nbr[i];
+    if( nbr == nullptr) continue;
+
+    Vertex *a = elt->v(i), *b = elt->v((i+1) % 3);
+    scalar he = length(a, b);
+    scalar nx = (b->y - a->y)/he, ny = -(b->x - a->x)/he;
+
+    scalar nbrJinvt[2][2];
+    inverseTransposedJacobian(nbr, nbrJinvt);
+
+    const Table &ours = *l.edge[i], &theirs = *l.nbrEdgeTable[i];
+    const Vector &v = *l.nbru[i];
+    size_t n = ours.rule.size();
+    scalar jump = 0;
+    for( size_t q = 0; q < n; q++) {
+      // the edge is traversed the other way around in the neighbour
+      auto &jets = ours.jets[q], &nbrjets = theirs.jets[n - 1 - q];
+      scalar gx = 0, gy = 0, ngx = 0, ngy = 0;
+      for( int k = 0; k < u.rows(); k++) { gx += u[k]*jets[k].x; gy += u[k]*jets[k].y; }
+      for( int k = 0; k < v.rows(); k++) { ngx += v[k]*nbrjets[k].x; ngy += v[k]*nbrjets[k].y; }
+
+      scalar x, y, nx2, ny2;
+      physicalGradient(Jinvt, gx, gy, x, y);
+      physicalGradient(nbrJinvt, ngx, ngy, nx2, ny2);
+      scalar val = (x - nx2)*nx + (y - ny2)*ny;
+      jump += ours.rule[q].w * val * val;
+    }
+    jump *= he;
+
+    scalar pe = max(l.p, l.nbrp[i]);
+    res += he/(2*pe) * jump;
+  }
+
+  return res;
+}
+}
+
+namespace ErrorEstimator {
+
+Residual::Residual(Partition &partition, const FEM::Solution &sol)
+  : ErrorEstimator::Base(partition, sol)
+{
+  const BasisEvaluator &evaluator = partition.bases().evaluator();
+  FEM::Rhs &rhs = partition.rhs();
+  ElementFinder finder(partition.leaves());
+
+  // gather the local vectors; this materializes lazy restrictions, so it
+  // is done serially
+  vector<Local> locals;
+  locals.reserve(partition.leaves().size());
+  for( Element *elt : partition.leaves()) {
+    Local l;
+    l.elt = elt;
+    l.u = &sol.locallyAt(elt);
+    l.f = &rhs.locallyAt(elt);
+    l.p = max(1, Degree::dofToDegree(l.u->rows()));
+    locals.push_back(l);
+  }
+
+  map<Element *, const Local *, TriangleSetCompare> byElement;
+  for( auto &l : locals) byElement[l.elt] = &l;
+  for( auto &l : locals) {
+    for( int i = 0; i < 3; i++) {
+      auto ee = finder.elementOppositeEdge(l.elt->edges()[i]);
+      l.nbr[i] = ee.first;
+      l.nbrEdge[i] = ee.second;
+      if( ee.first == nullptr) continue;
+      const Local *nl = byElement.at(ee.first);
+      l.nbru[i] = nl->u;
+      l.nbrp[i] = nl->p;
+    }
+  }
+
+  // the tables of basis functions that we need
+  map<InteriorKey, Table> interiors;
+  map<EdgeKey, Table> edges;
+  for( auto &l : locals) {
+    int tt = l.elt->type();
+    int pf = max(1, Degree::dofToDegree(l.f->rows()));
+    int dim = max(l.u->rows(), l.f->rows());
+    l.interior = &interiors[make_tuple(tt, dim, 2*max(l.p, pf))];
+
+    for( int i = 0; i < 3; i++) {
+      if( l.nbr[i] == nullptr) continue;
+      int deg = 2*max(l.p, l.nbrp[i]) - 2;
+      l.edge[i] = &edges[make_tuple(tt, i, (int) l.u->rows(), deg)];
+      l.nbrEdgeTable[i] = &edges[make_tuple(l.nbr[i]->type(), l.nbrEdge[i],
+                                            (int) l.nbru[i]->rows(), deg)];
+    }
+  }
+
+  vector<pair<const InteriorKey *, Table *>> interiorTodo;
+  for( auto &p : interiors) interiorTodo.push_back(make_pair(&p.first, &p.second));
+#pragma omp parallel for schedule(dynamic)
+  for( size_t k = 0; k < interiorTodo.size(); k++) {
+    int tt, dim, deg;
+    tie(tt, dim, deg) = *interiorTodo[k].first;
+    Table &table = *interiorTodo[k].second;
+    table.rule = Quadrature::triangle(deg);
+    table.jets.resize(table.rule.size());
+    for( size_t q = 0; q < table.rule.size(); q++) {
+      evaluator.evaluate(TriType(tt), table.rule[q].x, table.rule[q].y, dim, table.jets[q]);
+    }
+  }
+
+  vector<pair<const EdgeKey *, Table *>> edgeTodo;
+  for( auto &p : edges) edgeTodo.push_back(make_pair(&p.first, &p.second));
+#pragma omp parallel for schedule(dynamic)
+  for( size_t k = 0; k < edgeTodo.size(); k++) {
+    int tt, edge, dim, deg;
+    tie(tt, edge, dim, deg) = *edgeTodo[k].first;
+    Table &table = *edgeTodo[k].second;
+    table.rule = Quadrature::line(deg);
+    table.jets.resize(table.rule.size());
+    int next = (edge + 1) % 3;
+    for( size_t q = 0; q < table.rule.size(); q++) {
+      scalar t = table.rule[q].x;
+      scalar x = refx[edge] + t*(refx[next] - refx[edge]),
+             y = refy[edge] + t*(refy[next] - refy[edge]);
+      evaluator.evaluate(TriType(tt), x, y, dim, table.jets[q]);
+    }
+  }
+
+  // compute the local indicators
+  vector<scalar> values(locals.size());
+#pragma omp parallel for schedule(static)
+  for( size_t k = 0; k < locals.size(); k++) {
+    values[k] = indicator(locals[k]);
+  }
+
+  ElementScalarSet sqerrors;
+  for( size_t k = 0; k < locals.size(); k++) {
+    sqerrors.insert(sqerrors.end(), make_pair(locals[k].elt, values[k]));
+  }
+  _sqerrors = Errors(sqerrors);
+}
+
+}
@@ -0,0 +1,26 @@
+#pragma once
+
+#include "base.h"
+
+/**
+ *  Residual.h
+ *
+ *  The explicit residual error estimator for -Laplace u = f with homogeneous
+ *  Dirichlet conditions, with the p-dependent weights of Melenk and Wohlmuth:
+ *
+ *    eta_K^2 = (h_K/p_K)^2 ||f + Laplace u_h||_K^2
+ *            + sum_{interior edges e of K} h_e/(2 p_e) ||[d_n u_h]||_e^2,
+ *
+ *  where p_e is the maximum degree on both sides of e.  Unlike Refine, this
+ *  only looks at an element and its neighbours, so it is cheap and computed
+ *  for all leaves in parallel.  It is reliable and efficient only up to
+ *  constants (the efficiency constant depending on p), so its values are
+ *  not directly comparable to those of Refine.
+ */
+
+namespace ErrorEstimator {
+class Residual : public Base {
+public:
+  Residual(Partition &partition, const FEM::Solution &sol);
+};
+}
@@ -0,0 +1,117 @@
+#include <algorithm>
+#include <array>
+#include <map>
+#include <vector>
+#include <Eigen/Cholesky>
+
+#include "surplus.h"
+#include "../elementfinder.h"
+
+using namespace std;
+
+namespace {
+
+// everything we need to know about a leaf to compute its indicator
+struct Local {
+  Element *elt;
+  const Vector *u, *f;
+  int p;
+  array<int, 3> nbr, nbrEdge, edgeDegree;  // nbr -1 on the boundary
+
+  // the residual of the edge surplus functions and their energies
+  array<scalar, 3> r, a;
+  scalar face;
+};
+
+/**
+ *  The local residual (f, phi_i) - a(u_h, phi_i) for all basis functions up
+ *  to degree p+1, the energy of the face part of the surplus, and the edge
+ *  residuals and energies.  The edge function of degree p_e+1 on edge i is
+ *  function dim(p_e) + i, and the face functions of degree p+1 come right
+ *  after those of the edges of degree p+1.
+ */
+void compute(Local &l, int maxDegree) {
+  Element *elt = l.elt;
+  const Vector &u = *l.u, &f = *l.f;
+  int q = min(l.p + 1, maxDegree);
+  int dim = Degree::degreeToDim(q);
+
+  const Matrix eltmat = elt->elementMatrix(dim);
+  int fdim = min((int) f.rows(), dim);
+  int udim = min((int) u.rows(), dim);
+  Vector r = elt->massMatrix(dim, fdim) * f.head(fdim)
+           - eltmat.leftCols(udim) * u.head(udim);
+
+  for( int i = 0; i < 3; i++) {
+    l.r[i] = l.a[i] = 0;
+    if( l.nbr[i] == -1 || l.edgeDegree[i] >= maxDegree) continue;
+    int k = Degree::degreeToDim(l.edgeDegree[i]) + i;
+    l.r[i] = r[k];
+    l.a[i] = eltmat(k, k);
+  }
+
+  l.face = 0;
+  if( q > l.p && q >= 3) {
+    int first = Degree::degreeToDim(l.p) + 3;
+    int n = dim - first;
+    Vector rf = r.segment(first, n);
+    l.face = rf.dot(eltmat.block(first, first, n, n).ldlt().solve(rf));
+  }
+}
+}
+
+namespace ErrorEstimator {
+
+Surplus::Surplus(Partition &partition, const FEM::Solution &sol)
+  : ErrorEstimator::Base(partition, sol)
+{
+  FEM::Rhs &rhs = partition.rhs();
+  ElementFinder finder(partition.leaves());
+  int maxDegree = partition.bases().degree();
+
+  // gather the local vectors; this materializes lazy restrictions, and
+  // computes the triclasses that elementMatrix() needs, so it is serial
+  vector<Local> locals;
+  locals.reserve(partition.leaves().size());
+  map<Element *, int, TriangleSetCompare> number;
+  for( Element *elt : partition.leaves()) {
+    elt->triclass();
+    Local l;
+    l.elt = elt;
+    l.u = &sol.locallyAt(elt);
+    l.f = &rhs.locallyAt(elt);
+    l.p = max(1, Degree::dofToDegree(l.u->rows()));
+    number[elt] = locals.size();
+    locals.push_back(l);
+  }
+
+  for( auto &l : locals) {
+    for( int i = 0; i < 3; i++) {
+      auto ee = finder.elementOppositeEdge(l.elt->edges()[i]);
+      l.nbr[i] = ee.first == nullptr ? -1 : number.at(ee.first);
+      l.nbrEdge[i] = ee.second;
+      l.edgeDegree[i] = ee.first == nullptr ? 0 : min(l.p, locals[l.nbr[i]].p);
+    }
+  }
+
+#pragma omp parallel for schedule(dynamic)
+  for( size_t k = 0; k < locals.size(); k++) {
+    compute(locals[k], maxDegree);
+  }
+
+  // the edge functions are shared, so add the contributions of both sides
+  ElementScalarSet sqerrors;
+  for( auto &l : locals) {
+    scalar value = l.face;
+    for( int i = 0; i < 3; i++) {
+      if( l.a[i] == 0) continue;
+      const Local &n = locals[l.nbr[i]];
+      scalar r = l.r[i] + n.r[l.nbrEdge[i]], a = l.a[i] + n.a[l.nbrEdge[i]];
+      value += r * r / a / 2;
+    }
+    sqerrors.insert(sqerrors.end(), make_pair(l.elt, value));
+  }
+  _sqerrors = Errors(sqerrors);
+}
+
+}
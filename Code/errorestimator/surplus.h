@@ -0,0 +1,26 @@
+#pragma once
+
+#include "base.h"
+
+/**
+ *  Surplus.h
+ *
+ *  A hierarchical (Bank-Smith) error estimator.  Raising the degree of every
+ *  leaf by one adds, per element, the face functions of degree p+1, and per
+ *  interior edge, the edge function of degree p_e+1, where p_e is the minimum
+ *  degree on both sides.  Since the basis is hierarchical, these are just
+ *  the next functions in the tables.  We solve for the error in this surplus
+ *  space with a block-diagonal approximation of the stiffness matrix: one
+ *  dense block of face functions per element, and one function per edge.
+ *  The energy of an edge solution is split evenly over both sides.
+ *
+ *  No mesh is refined and no global system is solved, so all leaves are
+ *  handled in parallel.
+ */
+
+namespace ErrorEstimator {
+class Surplus : public Base {
+public:
+  Surplus(Partition &partition, const FEM::Solution &sol);
+};
+}
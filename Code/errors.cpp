@@ -1,4 +1,5 @@
 #include <cassert>
+#include <algorithm>
 
 #include "errors.h"
 
@@ -6,28 +7,74 @@ using namespace std;
 
 Errors::Errors(const ElementScalarSet &errors)
 {
-  for(auto p : errors) {
-    _errors.insert(p);
+  if (errors.empty()) return;
+
+  // the elements per generation, so that we can sum a generation at a time
+  long long maxIndex = 0;
+  int maxGen = 0;
+  for (auto &p : errors) {
+    maxIndex = max(maxIndex, p.first->index());
+    maxGen = max(maxGen, p.first->gen());
+  }
+  _errors.assign(maxIndex + 1, 0);
+  _known.assign(maxIndex + 1, false);
+
+  vector<vector<Element *>> generations(maxGen + 1);
+  for (auto &p : errors) {
+    _errors[p.first->index()] = p.second;
+    _known[p.first->index()] = true;
+    generations[p.first->gen()].push_back(p.first);
+  }
+
+  // children have a higher generation than their parents, so going up one
+  // generation at a time, both children of a parent are known by the time
+  // we sum them
+  for (int gen = maxGen; gen > 0; gen--) {
+    vector<Element *> parents;
+    for (Element *elt : generations[gen]) {
+      Element *parent = elt->parent();
+      if (_known[parent->index()]) continue;
+      _known[parent->index()] = true;
+      parents.push_back(parent);
+    }
+
+    long n = parents.size();
+#pragma omp parallel for schedule(static) if(n > 1024)
+    for (long i = 0; i < n; i++) {
+      Element *parent = parents[i];
+      assert(_known[parent->left()->index()] && _known[parent->right()->index()]);
+      _errors[parent->index()] = _errors[parent->left()->index()]
+                               + _errors[parent->right()->index()];
+    }
+
+    auto &up = generations[gen-1];
+    up.insert(up.end(), parents.begin(), parents.end());
   }
 }
 
-ElementScalarSet Errors::on(const ElementSet &elts)
+ElementScalarSet Errors::on(const ElementSet &elts) const
 {
   ElementScalarSet ret;
   for( auto elt : elts) {
-    ret.insert(make_pair(elt, on(elt)));
+    ret.insert(ret.end(), make_pair(elt, on(elt)));
   }
 
   return ret;
 }
 
-scalar Errors::on(Element *elt)
+scalar Errors::on(Element *elt) const
 {
-  if(_errors.count(elt) > 0) return _errors[elt];
-  assert(!elt->isLeaf());
+  assert(elt->index() < (long long) _known.size() && _known[elt->index()]);
+  return _errors[elt->index()];
+}
+
+vector<pair<scalar, Element *>> Errors::indicators(const ElementSet &elts) const
+{
+  vector<pair<scalar, Element *>> ret;
+  ret.reserve(elts.size());
+  for (auto elt : elts) {
+    ret.push_back(make_pair(on(elt), elt));
+  }
 
-  scalar ret = on(elt->left()) + on(elt->right());
-  _errors.insert(make_pair(elt, ret));
-  
   return ret;
 }
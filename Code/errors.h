@@ -1,18 +1,31 @@
 #pragma once
 
-#include <map>
+#include <vector>
+#include <utility>
 
 #include "triangleset.h"
 #include "element.h"
 
+/**
+ *  Local (squared) errors on a partition, and their sums on all ancestors.
+ *  The errors are stored in a dense array indexed by element index, filled
+ *  in one bottom-up pass when constructed, so that `on(elt)` is O(1).
+ */
 class Errors {
 public:
   Errors(const ElementScalarSet &errors);
   Errors() {}
 
-  ElementScalarSet on(const ElementSet &elts);
-  scalar on(Element *elt);
+  ElementScalarSet on(const ElementSet &elts) const;
+  scalar on(Element *elt) const;
+
+  /**
+   *  The errors on `elts` as (error, element) pairs in element order, as
+   *  consumed by Dorfler marking.
+   */
+  std::vector<std::pair<scalar, Element *>> indicators(const ElementSet &elts) const;
 
 private:
-  std::map<Element *, scalar> _errors;
+  std::vector<scalar> _errors;
+  std::vector<bool> _known;
 };
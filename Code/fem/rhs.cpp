@@ -10,10 +10,11 @@ void Rhs::retainOnly(ElementSet &elts) {
   ElementPairMap<Vector> newl2g;
   for(auto &elt : elts) {
     assert(has(elt));
-    newl2g.insert(*l2g.find(elt));
+    newl2g.insert(make_pair(elt, locallyAt(elt)));
   }
 
   l2g = newl2g;
+  _lazy.clear();
   _availableOn = elts;
   _definedOn = elts;
 }
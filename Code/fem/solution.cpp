@@ -5,6 +5,7 @@
 #include <vector>
 
 #include "../matrix.h"
+#include "../meshfile.h"
 
 using namespace std;
 
@@ -57,6 +58,8 @@ void Solution::insert_dofs(Element *elt, Dofs local, bool definedOn) {
 }
 
 Solution Solution::fromSolFile(string filename, ElementDofsSet elts, Rhs &rhs) {
+  if( MeshFile::isBinary(filename)) return fromBinarySolFile(filename, elts, rhs);
+
   ifstream solfile(filename);
   assert(solfile.good());
 
@@ -102,6 +105,38 @@ Solution Solution::fromSolFile(string filename, ElementDofsSet elts, Rhs &rhs) {
   return Solution(sol, elts, rhs);
 }
 
+Solution Solution::fromBinarySolFile(string filename, ElementDofsSet elts, Rhs &rhs) {
+  MeshFile solfile(filename);
+  assert(solfile.kind() == MeshFile::Sol);
+  assert(solfile.numElts() == elts.size());
+
+  int maxDof = 0;
+  for( auto p : elts) for( int gi : p.second.values()) maxDof = max(maxDof, gi);
+  Vector sol = Vector::Zero(maxDof + 1);
+
+  size_t i = 0;
+  for( auto eltdofs : elts) {
+    Element *elt = eltdofs.first;
+    Dofs dofs = eltdofs.second;
+    const MeshFile::Record &r = solfile.element(i);
+    assert(solfile.numCoeffs(i) == dofs.size());
+    assert( r.v[0] == elt->i(0) && r.v[1] == elt->i(1) && r.v[2] == elt->i(2)
+         && r.type == elt->type().toInt());
+
+    const scalar *values = solfile.coeffs(i++);
+    for( int j = 0; j < dofs.size(); j++) {
+      int dof = dofs.get(j);
+      if( dof == -1) {
+        assert(values[j] == 0.0);
+      } else {
+        sol[dof] = values[j];
+      }
+    }
+  }
+
+  return Solution(sol, elts, rhs);
+}
+
 Vector Solution::residualVector() { 
   cout << _systemMat.rows() << " " << _global.rows() << " " << _systemRhs.rows() << endl;
   return _systemMat * _global - _systemRhs; 
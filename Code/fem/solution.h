@@ -10,6 +10,7 @@
 #include "../triangleset.h"
 
 class Solver;
+class Checkpoint;
 
 namespace FEM {
 
@@ -28,6 +29,7 @@ class Solution : public PiecewisePolynomial {
 
   int numDOFs() { return _global.size(); }
 
+  // reads a text or a binary .sol file, see meshfile.h
   static Solution fromSolFile(std::string filename, ElementDofsSet elts, Rhs &rhs);
 
   Vector residualVector();
@@ -37,12 +39,16 @@ class Solution : public PiecewisePolynomial {
   Vector _systemRhs;
 
  private:
+  friend class ::Checkpoint;
+
   Vector _global;
   ElementDofsMap _g;
 
   Rhs _rhs;
 
   Vector indexSol(const Dofs &g);
+
+  static Solution fromBinarySolFile(std::string filename, ElementDofsSet elts, Rhs &rhs);
 };
 
 }
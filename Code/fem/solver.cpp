@@ -1,4 +1,6 @@
 #include <Eigen/Sparse>
+#include <cmath>
+#include <deque>
 #include <vector>
 #include <set>
 
@@ -99,12 +101,91 @@ void Solver::solveSystem() {
   cerr << cg.iterations() << endl;
 #endif
 
+  setSolution(sol);
+}
+
+void Solver::setSolution(Vector &sol) {
   _sol = Solution(sol, _elts, _femrhs);
 
   _sol._systemMat = _sysmat;
   _sol._systemRhs = _sysrhs;
 }
 
+/**
+ *  Jacobi-preconditioned CG.  In exact arithmetic, the energy norm of the
+ *  error of iterate k is ||x - x_k||_A^2 = sum_{j >= k} alpha_j r_j^T z_j, so
+ *  the terms of the last `Delay` iterations estimate (from below) the error
+ *  of the iterate `Delay` steps back; see Strakos and Tichy, "On error
+ *  estimation in the conjugate gradient method and why it works in finite
+ *  precision computations".  We stop once that estimate is below the
+ *  tolerance and keep the latest iterate, which is better still.
+ *
+ *  If CG does not converge in numDOFs() iterations, we solve directly.
+ */
+void Solver::solveSystem(scalar tolerance, const PiecewisePolynomial &guess) {
+  const int Delay = 4;
+  int n = numDOFs();
+
+  // the coefficients of the guess, which is conforming, so shared DOFs agree
+  Vector x = Vector::Zero(n);
+  for( auto &pair : _elts) {
+    Element *elt = pair.first;
+    const Dofs &dofs = pair.second;
+    if( !guess.has(elt)) continue;
+    const Vector &local = guess.locallyAt(elt);
+    for( int i = 0; i < dofs.size() && i < local.rows(); i++) {
+      if( dofs.is(i)) x[dofs.get(i)] = local[i];
+    }
+  }
+
+  Vector inv = _sysmat.diagonal().cwiseInverse();
+  Vector r = _sysrhs - _sysmat * x;
+  Vector z = inv.cwiseProduct(r);
+  Vector p = z;
+  scalar rz = r.dot(z);
+
+  std::deque<scalar> terms;
+  for( _iterations = 0; _iterations < n; _iterations++) {
+    if( rz <= 0) {
+      terms.clear();
+      break;
+    }
+
+    Vector Ap = _sysmat * p;
+    scalar alpha = rz / p.dot(Ap);
+    x += alpha * p;
+    r -= alpha * Ap;
+
+    terms.push_back(alpha * rz);
+    if( (int) terms.size() > Delay) terms.pop_front();
+    if( (int) terms.size() == Delay) {
+      scalar estimate = 0;
+      for( scalar term : terms) estimate += term;
+      if( estimate <= tolerance * tolerance) break;
+    }
+
+    z = inv.cwiseProduct(r);
+    scalar rznew = r.dot(z);
+    p = z + (rznew / rz) * p;
+    rz = rznew;
+  }
+
+  if( _iterations == n && n > 0) {
+    cerr << "CG did not converge in " << n << " iterations, solving directly" << endl;
+    _iterations = 0;
+    _algebraicError = 0;
+    solveSystem();
+    return;
+  }
+
+  _algebraicError = 0;
+  for( scalar term : terms) _algebraicError += term;
+  _algebraicError = sqrt(_algebraicError);
+  cerr << "CG took " << _iterations << " iterations; algebraic error " << _algebraicError << endl;
+
+  setSolution(x);
+}
+
 Solver::Solver(const ElementDofsMap &elts, Rhs &rhs)
     : _elts(elts), _femrhs(rhs) {
   //cout << "In solver with " << numDOFs() << " dofs" << endl;
@@ -119,4 +200,20 @@ Solver::Solver(const ElementDofsMap &elts, Rhs &rhs)
     solveSystem();
   }
 }
+
+Solver::Solver(const ElementDofsMap &elts, Rhs &rhs, scalar tolerance,
+               const PiecewisePolynomial &guess)
+    : _elts(elts), _femrhs(rhs) {
+  if( numDOFs() == 0) {
+    _sol = Solution(_sysrhs, _elts, _femrhs);
+  } else {
+    computeSystemMatrix();
+    computeSystemRhs();
+    if( tolerance > 0) {
+      solveSystem(tolerance, guess);
+    } else {
+      solveSystem();
+    }
+  }
+}
 }
@@ -11,8 +11,23 @@ public:
   Solver(const ElementDofsMap &elts, Rhs &rhs);
   Solver(const DOFHandler &handler, Rhs &rhs) : Solver(handler.map(), rhs) {}
 
+  /**
+   *  Solves inexactly with preconditioned CG, starting from the coefficients
+   *  of `guess` (zero where it is not available), until the estimated energy
+   *  norm of the algebraic error is below `tolerance`.  A tolerance <= 0
+   *  solves directly, like the constructors above.
+   */
+  Solver(const ElementDofsMap &elts, Rhs &rhs, scalar tolerance, const PiecewisePolynomial &guess);
+  Solver(const DOFHandler &handler, Rhs &rhs, scalar tolerance, const PiecewisePolynomial &guess)
+    : Solver(handler.map(), rhs, tolerance, guess) {}
+
   int numDOFs();
 
+  // for inexact solves: the number of CG iterations and the estimated
+  // energy norm of the algebraic error; both are 0 for direct solves
+  int iterations() const { return _iterations; }
+  scalar algebraicError() const { return _algebraicError; }
+
   const Solution        &sol()          const { return _sol; }
   const StiffnessMatrix &systemMatrix() const { return _sysmat; }
   const LoadVector      &systemRhs()    const { return _sysrhs; }
@@ -26,9 +41,14 @@ protected:
   LoadVector _sysrhs;
   StiffnessMatrix _sysmat;
 
+  int _iterations = 0;
+  scalar _algebraicError = 0;
+
   int estimateNonZeros();
   void computeSystemMatrix();
   void computeSystemRhs();
   void solveSystem();
+  void solveSystem(scalar tolerance, const PiecewisePolynomial &guess);
+  void setSolution(Vector &sol);
 };
 }
@@ -0,0 +1,98 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+
+#include "marking.h"
+#include "math.h"
+
+using namespace std;
+
+typedef pair<scalar, Element *> Indicator;
+
+scalar Marking::sum(const Indicator *v, size_t n) {
+  // the values are not contiguous, so sum pairwise over blocks of them
+  array<scalar, 64> partial;
+  size_t blocks = min(n, partial.size());
+#pragma omp parallel for schedule(static) if(n > 4096)
+  for( size_t b = 0; b < blocks; b++) {
+    scalar res = 0;
+    for( size_t i = b * n / blocks; i < (b+1) * n / blocks; i++) {
+      res += v[i].first;
+    }
+    partial[b] = res;
+  }
+  return Math::pairwiseSum(partial.data(), blocks);
+}
+
+/**
+ *  We keep v[0, lo) selected, and `needed` the part of the target that they do
+ *  not cover yet; the boundary of the marked set lies in v[lo, hi).  Each
+ *  step partitions v[lo, hi) around a pivot into larger and smaller pairs.
+ *  If the larger ones cover `needed`, the boundary is among them; otherwise
+ *  we select them and the pivot, and continue with the smaller ones.
+ */
+size_t Marking::selectLargest(Indicators &v, scalar needed) {
+  if( v.empty()) return 0;
+  if( needed <= 0) {
+    swap(v[0], *max_element(v.begin(), v.end()));
+    return 1;
+  }
+
+  size_t lo = 0, hi = v.size();
+  while( lo < hi) {
+    // median of three as pivot, moved to the end of the range
+    size_t mid = lo + (hi - lo) / 2;
+    if( v[mid] < v[lo]) swap(v[mid], v[lo]);
+    if( v[hi-1] < v[lo]) swap(v[hi-1], v[lo]);
+    if( v[mid] < v[hi-1]) swap(v[mid], v[hi-1]);
+    Indicator pivot = v[hi-1];
+
+    size_t g = partition(v.begin() + lo, v.begin() + hi - 1,
+                         [&](const Indicator &i) { return pivot < i; }) - v.begin();
+    swap(v[g], v[hi-1]);
+
+    scalar larger = sum(v.data() + lo, g - lo);
+    if( g > lo && larger >= needed) {
+      hi = g;
+    } else {
+      needed -= larger + pivot.first;
+      lo = g + 1;
+      if( needed <= 0) break;
+    }
+  }
+  return lo;
+}
+
+ElementSet Marking::dorfler(Indicators v, scalar theta, scalar sqtotal) {
+  size_t k = selectLargest(v, theta * theta * sqtotal);
+
+  ElementSet marked;
+  for( size_t i = 0; i < k; i++) marked.insert(v[i].second);
+  return marked;
+}
+
+ElementSet Marking::dorfler(const Indicators &indicators, scalar theta) {
+  return dorfler(indicators, theta, sum(indicators.data(), indicators.size()));
+}
+
+ElementSet Marking::maximum(const Indicators &indicators, scalar theta) {
+  scalar largest = 0;
+  for( auto &i : indicators) largest = max(largest, i.first);
+
+  ElementSet marked;
+  for( auto &i : indicators) {
+    if( i.first >= theta * theta * largest) marked.insert(i.second);
+  }
+  return marked;
+}
+
+ElementSet Marking::equilibration(const Indicators &indicators, scalar theta) {
+  if( indicators.empty()) return ElementSet();
+  scalar average = sum(indicators.data(), indicators.size()) / indicators.size();
+
+  ElementSet marked;
+  for( auto &i : indicators) {
+    if( i.first >= theta * theta * average) marked.insert(i.second);
+  }
+  return marked;
+}
@@ -0,0 +1,44 @@
+#pragma once
+
+#include <vector>
+#include <utility>
+
+#include "config.h"
+#include "element.h"
+#include "triangleset.h"
+
+/**
+ *  Marking strategies for adaptive refinement.  The indicators are squared
+ *  local errors as (error, element) pairs, as given by Errors::indicators().
+ *  All strategies run in expected linear time; none of them sorts.
+ */
+class Marking {
+public:
+  typedef std::vector<std::pair<scalar, Element *>> Indicators;
+
+  /**
+   *  Dorfler (bulk) marking: the smallest set of elements with the largest
+   *  indicators whose sum is at least theta^2 `sqtotal`; at least one element
+   *  is marked.  This is the same set as walking the indicators in descending
+   *  order (ties broken by descending pointer, as when sorting the pairs),
+   *  but found by quickselect on the threshold instead of by sorting.
+   */
+  static ElementSet dorfler(Indicators indicators, scalar theta, scalar sqtotal);
+  static ElementSet dorfler(const Indicators &indicators, scalar theta);
+
+  /**
+   *  Reorders `v` such that v[0, k) are the k largest indicators, with k the
+   *  smallest number whose sum is at least `needed` (or all of them), and
+   *  returns k.  This is the selection step of dorfler().
+   */
+  static size_t selectLargest(Indicators &v, scalar needed);
+
+  // all elements whose error is at least theta times the largest error
+  static ElementSet maximum(const Indicators &indicators, scalar theta);
+
+  // all elements whose squared error is at least theta^2 times the average
+  static ElementSet equilibration(const Indicators &indicators, scalar theta);
+
+  // the sum of the indicators, independent of the number of threads
+  static scalar sum(const std::pair<scalar, Element *> *v, size_t n);
+};
@@ -38,3 +38,13 @@ int Math::pow2roundup( int n) {
   n |= n >> 16;
   return n+1;
 }
+
+scalar Math::pairwiseSum(const scalar *v, size_t n) {
+  if( n <= 16) {
+    scalar res = 0;
+    for( size_t i = 0; i < n; i++) res += v[i];
+    return res;
+  }
+  size_t half = n / 2;
+  return pairwiseSum(v, half) + pairwiseSum(v + half, n - half);
+}
@@ -15,4 +15,12 @@ public:
   static int degree( int dof);
 
   static int pow2roundup(int n);
+
+  /**
+   *  Sums `n` values by recursively halving the range.  The rounding error
+   *  grows with log(n) instead of n, and the order of the additions only
+   *  depends on n, so parallel reductions that fill `v` give the same result
+   *  regardless of the number of threads.
+   */
+  static scalar pairwiseSum(const scalar *v, size_t n);
 };
@@ -47,16 +47,17 @@ void writeMatrix(string filename, Matrix mat, bool binary) {
   }
   int r = mat.rows();
   int c = mat.cols();
-  ofs << r << " " << c << endl;
+  Formatter f(ofs);
+  f << r << ' ' << c << '\n';
   for( int i = 0; i < r; i++) {
     for( int j = 0; j < c; j++) {
-      ofs << Print::formatted("%.70f", mat(i,j));
-      if( j < c-1) ofs << " ";
+      f.shortest(mat(i,j));
+      if( j < c-1) f << ' ';
     }
-    ofs << endl;
+    f << '\n';
   }
-  ofs << endl;
-  ofs.flush();
+  f << '\n';
+  f.flush();
   ofs.close();
 }
 
@@ -72,16 +73,17 @@ void writeMatrix(string filename, Vector mat, bool binary) {
   }
   int r = mat.rows();
   int c = mat.cols();
-  ofs << r << " " << c << endl;
+  Formatter f(ofs);
+  f << r << ' ' << c << '\n';
   for( int i = 0; i < r; i++) {
     for( int j = 0; j < c; j++) {
-      ofs << Print::formatted("%.70f", mat(i,j));
-      if( j < c-1) ofs << " ";
+      f.shortest(mat(i,j));
+      if( j < c-1) f << ' ';
     }
-    ofs << endl;
+    f << '\n';
   }
-  ofs << endl;
-  ofs.flush();
+  f << '\n';
+  f.flush();
   ofs.close();
 }
 
@@ -0,0 +1,160 @@
+#include <cassert>
+#include <cstring>
+#include <fstream>
+#include <iostream>
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "meshfile.h"
+#include "meshparser.h"
+#include "print.h"
+
+using namespace std;
+
+namespace {
+const char magic[8] = {'h', 'p', 'a', 'f', 'e', 'm', 'B', 'F'};
+const uint32_t version = 1;
+
+uint64_t aligned(uint64_t offset) { return (offset + 15) & ~uint64_t(15); }
+}
+
+bool MeshFile::isBinary(const string &filename) {
+  ifstream file(filename, ios::in | ios::binary);
+  char buf[sizeof(magic)];
+  return file.read(buf, sizeof(buf)) && memcmp(buf, magic, sizeof(magic)) == 0;
+}
+
+MeshFile::Data MeshFile::readText(const string &filename) {
+  return MeshParser::parse(filename);
+}
+
+void MeshFile::writeText(const Data &data, const string &filename) {
+  ofstream os(filename, ofstream::trunc);
+  assert(os.good());
+  Formatter f(os);
+
+  if( data.kind == Rhs) {
+    size_t nRhs = data.numRows() ? data.rows[1] : 0;
+    f << data.numRows() << ' ' << nRhs << '\n';
+    for( size_t i = 0; i < data.numRows(); i++) {
+      assert(data.rows[i + 1] - data.rows[i] == nRhs);
+      for( size_t j = data.rows[i]; j < data.rows[i + 1]; j++) {
+        if( j > data.rows[i]) f << ' ';
+        f.shortest(data.coeffs[j]);
+      }
+      f << '\n';
+    }
+    return;
+  }
+
+  if( data.kind == Sol) f << "tridim tritype sol\n";
+  f << data.numVerts() << '\n';
+  for( size_t i = 0; i < data.numVerts(); i++) {
+    f.shortest(data.xy[2*i]) << ' ';
+    f.shortest(data.xy[2*i + 1]);
+    if( data.kind == Sol) f << ' ' << (int) data.boundary[i];
+    f << '\n';
+  }
+
+  f << data.elts.size() << '\n';
+  for( size_t i = 0; i < data.elts.size(); i++) {
+    const Record &r = data.elts[i];
+    if( data.kind == Sol) f << data.rows[i + 1] - data.rows[i] << ' ';
+    f << r.v[0] << ' ' << r.v[1] << ' ' << r.v[2] << ' ' << r.type;
+    if( data.kind == Sol) {
+      for( size_t j = data.rows[i]; j < data.rows[i + 1]; j++) {
+        f << ' ';
+        f.shortest(data.coeffs[j]);
+      }
+    }
+    f << '\n';
+  }
+}
+
+void MeshFile::write(const Data &data, const string &filename) {
+  assert(data.kind == Rhs || data.elts.size() == data.numRows() || data.numRows() == 0);
+  assert(data.kind != Sol || data.boundary.size() == data.numVerts());
+
+  Header header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, magic, sizeof(magic));
+  header.version = version;
+  header.kind = data.kind;
+  header.scalarSize = sizeof(scalar);
+  header.numVerts = data.numVerts();
+  header.numElts = data.kind == Rhs ? data.numRows() : data.elts.size();
+  header.numCoeffs = data.coeffs.size();
+
+  // a mesh has no coefficients, but still gets (empty) rows
+  vector<uint64_t> rows = data.rows;
+  rows.resize(header.numElts + 1, rows.back());
+
+  header.xy = aligned(sizeof(Header));
+  header.boundary = aligned(header.xy + data.xy.size()*sizeof(scalar));
+  header.elts = aligned(header.boundary + data.boundary.size());
+  header.rows = aligned(header.elts + data.elts.size()*sizeof(Record));
+  header.coeffs = aligned(header.rows + rows.size()*sizeof(uint64_t));
+
+  ofstream os(filename, ios::out | ios::binary | ios::trunc);
+  assert(os.good());
+  auto put = [&os](uint64_t offset, const void *ptr, size_t bytes) {
+    while( (uint64_t) os.tellp() < offset) os.put(0);
+    os.write((const char *) ptr, bytes);
+  };
+  // long doubles have padding bytes that assignments leave alone; zero them,
+  // so that the same values always give the same file
+  auto putScalars = [&put](uint64_t offset, const vector<scalar> &values) {
+    vector<scalar> padded(values.size());
+    memset((void *) padded.data(), 0, padded.size()*sizeof(scalar));
+    for( size_t i = 0; i < values.size(); i++) padded[i] = values[i];
+    put(offset, padded.data(), padded.size()*sizeof(scalar));
+  };
+  put(0, &header, sizeof(header));
+  putScalars(header.xy, data.xy);
+  put(header.boundary, data.boundary.data(), data.boundary.size());
+  put(header.elts, data.elts.data(), data.elts.size()*sizeof(Record));
+  put(header.rows, rows.data(), rows.size()*sizeof(uint64_t));
+  putScalars(header.coeffs, data.coeffs);
+  assert(os.good());
+}
+
+MeshFile::MeshFile(const string &filename) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  assert(fd != -1);
+  struct stat st;
+  fstat(fd, &st);
+  _size = st.st_size;
+  _map = mmap(nullptr, _size, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  assert(_map != MAP_FAILED);
+
+  const char *base = (const char *) _map;
+  _header = (const Header *) base;
+  assert(_size >= sizeof(Header) && memcmp(_header->magic, magic, sizeof(magic)) == 0);
+  assert(_header->version == version && "unknown binary mesh file version");
+  assert(_header->scalarSize == sizeof(scalar) && "binary mesh file of another scalar type");
+  assert(_header->coeffs + _header->numCoeffs*sizeof(scalar) <= _size && "truncated binary mesh file");
+
+  _xy = (const scalar *) (base + _header->xy);
+  _boundary = (const uint8_t *) (base + _header->boundary);
+  _elts = (const Record *) (base + _header->elts);
+  _rows = (const uint64_t *) (base + _header->rows);
+  _coeffs = (const scalar *) (base + _header->coeffs);
+}
+
+MeshFile::~MeshFile() {
+  munmap(_map, _size);
+}
+
+MeshFile::Data MeshFile::data() const {
+  Data data;
+  data.kind = kind();
+  data.xy.assign(_xy, _xy + 2*numVerts());
+  if( kind() == Sol) data.boundary.assign(_boundary, _boundary + numVerts());
+  if( kind() != Rhs) data.elts.assign(_elts, _elts + numElts());
+  data.rows.assign(_rows, _rows + numElts() + 1);
+  data.coeffs.assign(_coeffs, _coeffs + _header->numCoeffs);
+  return data;
+}
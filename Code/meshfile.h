@@ -0,0 +1,98 @@
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <vector>
+
+#include "config.h"
+
+/**
+ *  MeshFile.h
+ *
+ *  A binary form of the .mesh, .rhs and .sol text files, which is read by
+ *  mapping it into memory instead of parsing it.  A file consists of
+ *
+ *    Header    magic, version, kind, sizeof(scalar), the counts below and
+ *              the byte offsets of the arrays below
+ *    scalar    xy[2*numVerts]           the vertices
+ *    uint8     boundary[numVerts]       the boundary flags (.sol only)
+ *    Record    elts[numElts]            the elements (.mesh and .sol)
+ *    uint64    rows[numElts + 1]        CSR row pointers into coeffs
+ *    scalar    coeffs[numCoeffs]        the local vectors (.rhs and .sol)
+ *
+ *  in the byte order of this machine, with every array 16-byte aligned.  The
+ *  coefficients are stored as `scalar`, so nothing is lost with respect to
+ *  the text files.  Whether a file is binary is told by its magic, not its
+ *  extension, so the readers accept either form under the usual names.
+ */
+class MeshFile {
+public:
+  enum Kind : uint32_t { Mesh = 1, Rhs = 2, Sol = 3 };
+
+  struct Record {
+    int32_t v[3];
+    int32_t type;
+  };
+
+  // the contents of a file, for writing and converting
+  struct Data {
+    Kind kind = Mesh;
+    std::vector<scalar> xy;
+    std::vector<uint8_t> boundary;
+    std::vector<Record> elts;
+    std::vector<uint64_t> rows = {0};
+    std::vector<scalar> coeffs;
+
+    size_t numVerts() const { return xy.size()/2; }
+    size_t numRows() const { return rows.size() - 1; }
+  };
+
+  static bool isBinary(const std::string &filename);
+
+  /**
+   *  The text files; the kind is told by the extension, or by the first line
+   *  of a .sol file.
+   */
+  static Data readText(const std::string &filename);
+  static void writeText(const Data &data, const std::string &filename);
+
+  static void write(const Data &data, const std::string &filename);
+
+  // maps the binary file `filename`
+  MeshFile(const std::string &filename);
+  ~MeshFile();
+  MeshFile(const MeshFile &) = delete;
+  MeshFile &operator=(const MeshFile &) = delete;
+
+  Kind kind() const { return (Kind) _header->kind; }
+  size_t numVerts() const { return _header->numVerts; }
+  size_t numElts() const { return _header->numElts; }
+
+  scalar x(size_t i) const { return _xy[2*i]; }
+  scalar y(size_t i) const { return _xy[2*i + 1]; }
+  bool boundary(size_t i) const { return _boundary[i]; }
+  const Record &element(size_t i) const { return _elts[i]; }
+
+  // the local vector of element i
+  const scalar *coeffs(size_t i) const { return _coeffs + _rows[i]; }
+  int numCoeffs(size_t i) const { return _rows[i + 1] - _rows[i]; }
+
+  Data data() const;
+
+private:
+  struct Header {
+    char magic[8];
+    uint32_t version, kind, scalarSize, reserved;
+    uint64_t numVerts, numElts, numCoeffs;
+    uint64_t xy, boundary, elts, rows, coeffs;
+  };
+
+  void *_map;
+  size_t _size;
+  const Header *_header;
+  const scalar *_xy;
+  const uint8_t *_boundary;
+  const Record *_elts;
+  const uint64_t *_rows;
+  const scalar *_coeffs;
+};
@@ -0,0 +1,328 @@
+#include <cassert>
+#include <charconv>
+#include <cstdint>
+#include <cstdlib>
+#include <cstring>
+#include <iostream>
+#include <limits>
+#include <fcntl.h>
+#include <omp.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "meshparser.h"
+
+using namespace std;
+
+namespace {
+bool endsWith(const string &s, const string &end) {
+  return s.size() >= end.size() && s.compare(s.size() - end.size(), end.size(), end) == 0;
+}
+
+bool isSpace(char c) { return c == ' ' || c == '\t' || c == '\r' || c == '\n'; }
+
+// reads whitespace separated numbers from [p, end)
+class Cursor {
+public:
+  Cursor(const char *p, const char *end) : _p(p), _end(end) {}
+
+  bool atEnd() {
+    while( _p < _end && isSpace(*_p)) _p++;
+    return _p == _end;
+  }
+
+  template<typename T>
+  bool next(T &value) {
+    if( atEnd()) return false;
+    auto result = from_chars(_p, _end, value);
+    return done(result.ec == errc() ? result.ptr : _p);
+  }
+
+  bool next(scalar &value) {
+    if( atEnd()) return false;
+    if( fast(value)) return true;
+#ifdef __cpp_lib_to_chars
+    auto result = from_chars(_p, _end, value);
+    return done(result.ec == errc() ? result.ptr : _p);
+#else
+    const char *token = _p;
+    while( _p < _end && !isSpace(*_p)) _p++;
+    string copy(token, _p);
+    char *last;
+    value = strtold(copy.c_str(), &last);
+    return done(token + (last - copy.c_str()));
+#endif
+  }
+
+private:
+  const char *_p, *_end;
+
+  /**
+   *  Plain decimals with at most 19 digits, like all the printers write, are
+   *  an integer that fits a uint64 divided by a power of ten that a long
+   *  double holds exactly.  A single division then rounds correctly, so this
+   *  gives the same value as from_chars, but much faster.  That needs the
+   *  64-bit mantissa of x87 long doubles.
+   */
+  bool fast(scalar &value) {
+    if( numeric_limits<scalar>::digits != 64) return false;
+    const char *p = _p;
+    bool negative = p < _end && *p == '-';
+    if( negative) p++;
+    uint64_t mantissa = 0;
+    int digits = 0, decimals = -1;
+    for( ; p < _end; p++) {
+      if( *p >= '0' && *p <= '9') {
+        if( ++digits > 19) return false;
+        mantissa = 10*mantissa + (*p - '0');
+        if( decimals >= 0) decimals++;
+      } else if( *p == '.' && decimals < 0) {
+        decimals = 0;
+      } else {
+        break;
+      }
+    }
+    if( digits == 0 || (p < _end && !isSpace(*p)) || decimals > 27) return false;
+
+    long double power = 1;
+    for( int i = 0; i < decimals; i++) power *= 10;
+    value = (long double) mantissa / power;
+    if( negative) value = -value;
+    _p = p;
+    return true;
+  }
+
+  // a number has to end at whitespace
+  bool done(const char *last) {
+    if( last == _p || (last < _end && !isSpace(*last))) return false;
+    _p = last;
+    return true;
+  }
+};
+}
+
+MeshParser::MeshParser(const char *begin, const char *end) : _begin(begin), _end(end) {
+  indexLines();
+}
+
+/**
+ *  Finds the starts of all lines, counting the newlines of chunks of the
+ *  text in parallel first, so that every chunk knows where to put its own.
+ */
+void MeshParser::indexLines() {
+  size_t size = _end - _begin;
+  int chunks = size > (1 << 20) ? 4*omp_get_max_threads() : 1;
+  vector<size_t> offsets(chunks + 1, 0);
+
+#pragma omp parallel for schedule(static)
+  for( int c = 0; c < chunks; c++) {
+    const char *p = _begin + size*c/chunks, *end = _begin + size*(c + 1)/chunks;
+    size_t count = 0;
+    while( (p = (const char *) memchr(p, '\n', end - p))) {
+      count++;
+      p++;
+    }
+    offsets[c + 1] = count;
+  }
+  for( int c = 0; c < chunks; c++) offsets[c + 1] += offsets[c];
+
+  _lines.resize(offsets[chunks] + 2);
+  _lines[0] = _begin;
+  _lines.back() = _end;
+#pragma omp parallel for schedule(static)
+  for( int c = 0; c < chunks; c++) {
+    const char *p = _begin + size*c/chunks, *end = _begin + size*(c + 1)/chunks;
+    size_t line = offsets[c];
+    while( (p = (const char *) memchr(p, '\n', end - p))) _lines[++line] = ++p;
+  }
+}
+
+void MeshParser::fail(size_t line, const string &what) {
+#pragma omp critical(meshparser_fail)
+  if( line < _error.line) {
+    _error.line = line;
+    _error.what = what;
+  }
+}
+
+bool MeshParser::counts(size_t *values, int count) {
+  size_t numLines = _lines.size() - 1;
+  while( _next < numLines && Cursor(_lines[_next], lineEnd(_next)).atEnd()) _next++;
+  if( _next == numLines) {
+    fail(numLines - 1, "unexpected end of file");
+    return false;
+  }
+
+  Cursor cursor(_lines[_next], lineEnd(_next));
+  for( int i = 0; i < count; i++) {
+    if( !cursor.next(values[i])) {
+      fail(_next, "expected " + to_string(count) + (count == 1 ? " count" : " counts"));
+      return false;
+    }
+  }
+  if( !cursor.atEnd()) {
+    fail(_next, "trailing characters");
+    return false;
+  }
+  _next++;
+  return true;
+}
+
+void MeshParser::vertices(MeshFile::Data &data) {
+  size_t n;
+  if( !counts(&n, 1)) return;
+  if( _next + n > _lines.size() - 1) {
+    fail(_lines.size() - 2, "expected " + to_string(n) + " vertices");
+    return;
+  }
+
+  bool sol = data.kind == MeshFile::Sol;
+  data.xy.resize(2*n);
+  if( sol) data.boundary.resize(n);
+#pragma omp parallel for schedule(static)
+  for( size_t i = 0; i < n; i++) {
+    size_t line = _next + i;
+    Cursor cursor(_lines[line], lineEnd(line));
+    int boundary = 0;
+    if( !cursor.next(data.xy[2*i]) || !cursor.next(data.xy[2*i + 1]) || (sol && !cursor.next(boundary))) {
+      fail(line, sol ? "expected x, y and the boundary flag" : "expected x and y");
+    } else if( !cursor.atEnd()) {
+      fail(line, "trailing characters");
+    } else if( sol) {
+      data.boundary[i] = boundary;
+    }
+  }
+  _next += n;
+}
+
+void MeshParser::elements(MeshFile::Data &data) {
+  size_t n;
+  if( !counts(&n, 1)) return;
+  if( _next + n > _lines.size() - 1) {
+    fail(_lines.size() - 2, "expected " + to_string(n) + " elements");
+    return;
+  }
+
+  // the local vectors of a solution can have any length, so find those first
+  bool sol = data.kind == MeshFile::Sol;
+  data.rows.assign(n + 1, 0);
+  if( sol) {
+#pragma omp parallel for schedule(static)
+    for( size_t i = 0; i < n; i++) {
+      Cursor cursor(_lines[_next + i], lineEnd(_next + i));
+      if( !cursor.next(data.rows[i + 1])) fail(_next + i, "expected the number of coefficients");
+    }
+    if( _error.line != (size_t) -1) return;
+    for( size_t i = 0; i < n; i++) data.rows[i + 1] += data.rows[i];
+  }
+
+  int numVerts = data.numVerts();
+  data.elts.resize(n);
+  data.coeffs.resize(data.rows.back());
+#pragma omp parallel for schedule(static)
+  for( size_t i = 0; i < n; i++) {
+    size_t line = _next + i;
+    Cursor cursor(_lines[line], lineEnd(line));
+    MeshFile::Record &r = data.elts[i];
+    size_t dim = 0;
+    if( (sol && !cursor.next(dim)) || !cursor.next(r.v[0]) || !cursor.next(r.v[1])
+        || !cursor.next(r.v[2]) || !cursor.next(r.type)) {
+      fail(line, "expected three vertices and a tritype");
+      continue;
+    }
+    if( r.v[0] < 0 || r.v[0] >= numVerts || r.v[1] < 0 || r.v[1] >= numVerts || r.v[2] < 0 || r.v[2] >= numVerts) {
+      fail(line, "vertex out of range");
+      continue;
+    }
+    if( r.type < 0 || r.type >= 8) {
+      fail(line, "tritype out of range");
+      continue;
+    }
+    for( size_t j = data.rows[i]; j < data.rows[i + 1]; j++) {
+      if( !cursor.next(data.coeffs[j])) {
+        fail(line, "expected " + to_string(dim) + " coefficients");
+        break;
+      }
+    }
+    if( !cursor.atEnd()) fail(line, "trailing characters");
+  }
+  _next += n;
+}
+
+void MeshParser::rhs(MeshFile::Data &data) {
+  size_t n[2];
+  if( !counts(n, 2)) return;
+  if( _next + n[0] > _lines.size() - 1) {
+    fail(_lines.size() - 2, "expected " + to_string(n[0]) + " elements");
+    return;
+  }
+
+  data.rows.resize(n[0] + 1);
+  for( size_t i = 0; i <= n[0]; i++) data.rows[i] = i*n[1];
+  data.coeffs.resize(n[0]*n[1]);
+#pragma omp parallel for schedule(static)
+  for( size_t i = 0; i < n[0]; i++) {
+    size_t line = _next + i;
+    Cursor cursor(_lines[line], lineEnd(line));
+    for( size_t j = 0; j < n[1]; j++) {
+      if( !cursor.next(data.coeffs[i*n[1] + j])) {
+        fail(line, "expected " + to_string(n[1]) + " coefficients");
+        break;
+      }
+    }
+    if( !cursor.atEnd()) fail(line, "trailing characters");
+  }
+  _next += n[0];
+}
+
+bool MeshParser::parse(const string &filename, MeshFile::Data &data, string &error) {
+  int fd = open(filename.c_str(), O_RDONLY);
+  if( fd == -1) {
+    error = filename + ": cannot open";
+    return false;
+  }
+  struct stat st;
+  fstat(fd, &st);
+  size_t size = st.st_size;
+  void *m = size ? mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0) : MAP_FAILED;
+  close(fd);
+  if( m == MAP_FAILED) {
+    error = filename + (size ? ": cannot map" : ": empty file");
+    return false;
+  }
+
+  const char *text = (const char *) m;
+  MeshParser parser(text, text + size);
+  data = MeshFile::Data();
+  if( endsWith(filename, ".rhs")) {
+    data.kind = MeshFile::Rhs;
+    parser.rhs(data);
+  } else {
+    data.kind = endsWith(filename, ".sol") ? MeshFile::Sol : MeshFile::Mesh;
+    if( data.kind == MeshFile::Sol) {
+      // the first line holds the settings
+      string settings = " " + string(text, parser.lineEnd(0)) + " ";
+      for( char &c : settings) if( isSpace(c)) c = ' ';
+      if( settings.find(" sol ") == string::npos) parser.fail(0, "not a solution");
+      parser._next = 1;
+    }
+    if( parser._error.what.empty()) parser.vertices(data);
+    if( parser._error.what.empty()) parser.elements(data);
+  }
+  munmap(m, size);
+
+  if( parser._error.what.empty()) return true;
+  error = filename + ":" + to_string(parser._error.line + 1) + ": " + parser._error.what;
+  return false;
+}
+
+MeshFile::Data MeshParser::parse(const string &filename) {
+  MeshFile::Data data;
+  string error;
+  if( !parse(filename, data, error)) {
+    cerr << error << endl;
+    exit(1);
+  }
+  return data;
+}
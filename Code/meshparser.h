@@ -0,0 +1,55 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "meshfile.h"
+
+/**
+ *  MeshParser.h
+ *
+ *  Parses the text .mesh, .sol and .rhs files into a MeshFile::Data.  The
+ *  file is mapped and split into lines, and the lines of the vertex and
+ *  element blocks are then parsed in parallel with from_chars.  Every vertex
+ *  and element has to be on a line of its own, as the printers write them;
+ *  blank lines are allowed around the counts.
+ *
+ *  Malformed input is reported as "file:line: what is wrong", for the first
+ *  line that is wrong.
+ */
+class MeshParser {
+public:
+  /**
+   *  Parses `filename` into `data`; the kind is told by the extension, as in
+   *  MeshFile::readText.  Returns false and sets `error` if it is malformed.
+   */
+  static bool parse(const std::string &filename, MeshFile::Data &data, std::string &error);
+
+  // as above, but stops the program on malformed input
+  static MeshFile::Data parse(const std::string &filename);
+
+private:
+  struct Error {
+    size_t line = (size_t) -1;
+    std::string what;
+  };
+
+  MeshParser(const char *begin, const char *end);
+
+  // the lines and their starts, ending with the end of the text
+  const char *_begin, *_end;
+  std::vector<const char *> _lines;
+  size_t _next = 0;
+  Error _error;
+
+  void indexLines();
+  const char *lineEnd(size_t line) const { return _lines[line + 1]; }
+
+  // the next non-blank line, which should hold exactly `count` numbers
+  bool counts(size_t *values, int count);
+  void fail(size_t line, const std::string &what);
+
+  void vertices(MeshFile::Data &data);
+  void elements(MeshFile::Data &data);
+  void rhs(MeshFile::Data &data);
+};
@@ -19,8 +19,10 @@ void NearBest::combineRoots() {
   queue<Element *> push;
   queue<Element *> pull;
 
+  _combinedRoots.clear();
   for( auto &root : partition.roots()) {
     push.push(root);
+    _combinedRoots.push_back(root);
   }
 
   int totalAdded = 0;
@@ -73,40 +75,47 @@ void NearBest::combineRoots() {
   _root = push.front(); push.pop();
 }
 
-void NearBest::removeCombinedRoots() {
-  removeCombinedRootsRecursive(_root);
-  _virtuals.clear();
-  _combinations.clear();
-  _root = nullptr;
+/**
+ *  Hooks the partition roots back under the combination tree that was built
+ *  in an earlier run.  If the roots of the partition changed since then, the
+ *  old combination tree is thrown away and a new one is built.
+ */
+void NearBest::attachCombinedRoots() {
+  vector<Element *> roots(partition.roots().begin(), partition.roots().end());
+  if( _root != nullptr && roots != _combinedRoots) {
+    deleteCombinedRoots();
+  }
+
+  if( _root == nullptr) {
+    combineRoots();
+    return;
+  }
+
+  for( auto &elt : _combinations) {
+    elt->left()->_parent = elt;
+    elt->right()->_parent = elt;
+  }
+}
+
+void NearBest::detachCombinedRoots() {
+  detachCombinedRootsRecursive(_root);
 }
 
-void NearBest::removeCombinedRootsRecursive(Element *elt) {
+void NearBest::detachCombinedRootsRecursive(Element *elt) {
   if (DEBUG) {
     cout << "now looking at " << elt->index() << endl;
   }
   // virtuals are leaves
   if( _virtuals.find(elt) != _virtuals.end()) {
-    //cout << "erasing virtual " << elt->index() << endl;
     if(_nearbestleaves.find(elt) != _nearbestleaves.end()) 
       _nearbestleaves.erase(elt);
-    _virtuals.erase(elt);
     assert(elt->isLeaf());
-
-    // remove every trace
-    _e.erase(elt);
-    _ehp.erase(elt);
-    _ehpTilde.erase(elt);
-    _eTilde.erase(elt);
-    _r.erase(elt);
-    _t.erase(elt);
-    _q.erase(elt);
-    delete elt;
     return;
   }
 
   if( _combinations.find(elt) != _combinations.end()) {
     if (DEBUG) {
-      cout << "erasing combination " << elt->index() << " with children "
+      cout << "detaching combination " << elt->index() << " with children "
            << elt->left()->index() << " " << elt->right()->index() << endl;
     }
     assert(!elt->isLeaf());
@@ -117,7 +126,6 @@ void NearBest::removeCombinedRootsRecursive(Element *elt) {
       if (DEBUG) {
         cout << "we are a nearbest leaf; inserting to children" << endl;
       }
-      assert(!elt->isLeaf());
       _nearbestleaves.insert(elt->left());
       _nearbestleaves.insert(elt->right());
       _nearbestleaves.erase(elt);
@@ -134,31 +142,35 @@ void NearBest::removeCombinedRootsRecursive(Element *elt) {
         }
       }
     }
-    _combinations.erase(elt);
 
     elt->left()->_parent = nullptr;
     elt->right()->_parent = nullptr;
     if (DEBUG) {
       cout << "recursing into children" << endl;
     }
-    removeCombinedRootsRecursive(elt->left());
-    removeCombinedRootsRecursive(elt->right());
+    detachCombinedRootsRecursive(elt->left());
+    detachCombinedRootsRecursive(elt->right());
+  }
+}
 
-    if (DEBUG) {
-      cout << "children of " << elt->index() << " are fixed" << endl;
+void NearBest::deleteCombinedRoots() {
+  for( auto &elt : _combinations) {
+    // the roots of the partition may still hang below us
+    for( auto &child : {elt->left(), elt->right()}) {
+      if( child->parent() == elt) child->_parent = nullptr;
     }
-    // remove every trace
-    _e.erase(elt);
-    _ehp.erase(elt);
-    _ehpTilde.erase(elt);
-    _eTilde.erase(elt);
-    _r.erase(elt);
-    _t.erase(elt);
-    _q.erase(elt);
-
-    delete elt;
-    return;
   }
+
+  for( auto &elts : {&_combinations, &_virtuals}) {
+    for( auto &elt : *elts) {
+      _e.erase(elt);
+      delete elt;
+    }
+    elts->clear();
+  }
+
+  _combinedRoots.clear();
+  _root = nullptr;
 }
 
 scalar NearBest::error(Element *elt, int dof) {
@@ -409,18 +421,30 @@ scalar NearBest::errorOnRoots() {
   return s;
 }
 
-NearBest::NearBest(Partition &partition, PiecewisePolynomial &poly, 
-                   scalar epsilon, int maxN, std::ostream& os) : 
-                   partition(partition), poly(poly)
-{
-  combineRoots();
+NearBest::NearBest(Partition &partition, PiecewisePolynomial &poly) :
+                   partition(partition), poly(poly) {}
+
+NearBest::~NearBest() {
+  if( _root != nullptr) deleteCombinedRoots();
+}
+
+void NearBest::run(scalar epsilon, int maxN, std::ostream& os) {
+  attachCombinedRoots();
 
   poly.print(std::cout);
   os << "4 " << epsilon << std::endl;
   assert(maxN > 0);
   //cout << "Nearbest step 1" << endl;
-  /* step 1: setup */
+  /* step 1: setup; only the combination tree is kept from a previous run */
   _nearbestleaves.clear();
+  _e.clear();
+  _ehp.clear();
+  _ehpTilde.clear();
+  _eTilde.clear();
+  _r.clear();
+  _t.clear();
+  _q.clear();
+
   _nearbestleaves.insert(_root);
 
   //cout << "NIEUWE ROOT " << root->index() << endl;
@@ -557,7 +581,7 @@ NearBest::NearBest(Partition &partition, PiecewisePolynomial &poly,
   if (DEBUG) {
     cout << "hier benm ik" << endl;
   }
-  removeCombinedRoots();
+  detachCombinedRoots();
 
   if (DEBUG) {
     cout << "hier dan" << endl;
@@ -30,7 +30,11 @@ private:
   ElementSet _virtuals;
   ElementSet _combinations;
 
-  Element *_root;
+  Element *_root = nullptr;
+
+  // The partition roots the combination tree was built on; the tree is kept
+  // across calls to run() as long as these do not change.
+  std::vector<Element *> _combinedRoots;
 
   ElementPairMap<std::map<int, scalar>> _e;
   ElementPairMap<std::map<int, scalar>> _ehp;
@@ -47,8 +51,10 @@ private:
   void setupLeaf(Element *leaf);
   void eraseFromDataStructures(Element *elt);
   void combineRoots();
-  void removeCombinedRoots();
-  void removeCombinedRootsRecursive(Element *elt);
+  void attachCombinedRoots();
+  void detachCombinedRoots();
+  void detachCombinedRootsRecursive(Element *elt);
+  void deleteCombinedRoots();
 
   void print(std::ostream &os, Element *e);
   int countRealLeavesInSubTree(Element *e, bool parentWasLeaf = false);
@@ -67,9 +73,19 @@ protected:
   void setDOFvalues();
 
 public:
-  NearBest(Partition &partition, PiecewisePolynomial &poly, scalar epsilon, int maxN, std::ostream& os);
+  /**
+   *  A NearBest object may be kept alive between outer hp-AFEM iterations and
+   *  run() repeatedly: the combination tree over the roots is then reused as
+   *  long as the roots do not change.  All errors are recomputed every run.
+   */
+  NearBest(Partition &partition, PiecewisePolynomial &poly);
+  NearBest(Partition &partition, PiecewisePolynomial &poly, scalar epsilon, int maxN, std::ostream& os) :
+    NearBest(partition, poly) { run(epsilon, maxN, os); }
   NearBest(Partition &partition, PiecewisePolynomial &poly, scalar epsilon, int maxN) :
     NearBest(partition, poly, epsilon, maxN, std::cerr) {}
+  ~NearBest();
+
+  void run(scalar epsilon, int maxN, std::ostream &os = std::cerr);
 
   void printNearBestLeafHpErrors(const std::string &filename);
   scalar errorOnRoots();
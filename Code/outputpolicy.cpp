@@ -0,0 +1,117 @@
+#include <cassert>
+#include <cstdlib>
+#include <fstream>
+#include <iostream>
+#include <map>
+
+#include "asyncwriter.h"
+#include "outputpolicy.h"
+#include "partition.h"
+#include "vtufile.h"
+
+using namespace std;
+
+namespace {
+string basename(const string &path) {
+  auto slash = path.find_last_of("/");
+  return slash == string::npos ? path : path.substr(slash + 1);
+}
+
+string dirname(const string &path) {
+  auto slash = path.find_last_of("/");
+  return slash == string::npos ? "" : path.substr(0, slash + 1);
+}
+
+// splits "<index> <rest>" of a delta line
+long long splitIndex(const string &line, string &rest) {
+  auto space = line.find(' ');
+  assert(space != string::npos);
+  rest = line.substr(space + 1);
+  return atoll(line.c_str());
+}
+
+// applies the delta in `filename` to the lines of a solution
+void apply(const string &filename, vector<string> &verts, map<long long, string> &elts) {
+  ifstream file(filename);
+  assert(file.good() && "missing delta file");
+
+  string line, rest;
+  getline(file, line);
+  assert(line == "tridim tritype sol delta");
+
+  size_t numVerts, numLines;
+  file >> numVerts >> numLines;
+  getline(file, line);
+  verts.resize(numVerts);
+  for( size_t i = 0; i < numLines; i++) {
+    getline(file, line);
+    long long index = splitIndex(line, rest);
+    verts[index] = rest;
+  }
+
+  size_t numElts, numRemoved;
+  file >> numElts >> numRemoved >> numLines;
+  getline(file, line);
+  for( size_t i = 0; i < numRemoved; i++) {
+    getline(file, line);
+    elts.erase(atoll(line.c_str()));
+  }
+  for( size_t i = 0; i < numLines; i++) {
+    getline(file, line);
+    long long index = splitIndex(line, rest);
+    elts[index] = rest;
+  }
+  assert(!file.fail() && elts.size() == numElts);
+}
+}
+
+bool OutputPolicy::parseCadence(const string &arg) {
+  if( arg == "outer") {
+    every = 0;
+    return true;
+  }
+  every = atoi(arg.c_str());
+  return every > 0;
+}
+
+void OutputPolicy::printSolution(Partition &p, const string &filename, const Errors *errors) {
+  if( vtu) {
+    auto dot = filename.find_last_of(".");
+    VTUFile::write(p, p.sol(), filename.substr(0, dot) + ".vtu", errors);
+  }
+
+  if( !delta) {
+    p.printSolution(filename);
+    return;
+  }
+
+  p.printSolutionDelta(filename + ".delta", _last);
+  assert(dirname(filename) == dirname(_manifest));
+  _written.push_back(basename(filename));
+  auto written = _written;
+  AsyncWriter::instance().write(_manifest, [written](ostream &os) {
+    for( auto &name : written) os << name << endl;
+  });
+}
+
+bool OutputPolicy::reconstruct(const string &manifest, const string &name, const string &filename) {
+  ifstream file(manifest);
+  if( !file.good()) return false;
+
+  vector<string> verts;
+  map<long long, string> elts;
+  string written;
+  while( getline(file, written)) {
+    apply(dirname(manifest) + written + ".delta", verts, elts);
+    if( written != basename(name)) continue;
+
+    ofstream os(filename, ofstream::trunc);
+    os << "tridim tritype sol" << endl;
+    os << verts.size() << endl;
+    for( auto &line : verts) os << line << endl;
+    os << elts.size() << endl;
+    for( auto &elt : elts) os << elt.second << endl;
+    return os.good();
+  }
+  return false;
+}
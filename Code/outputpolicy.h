@@ -0,0 +1,69 @@
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+class Errors;
+class Partition;
+struct PrintSnapshot;
+
+/**
+ *  OutputPolicy.h
+ *
+ *  When and how the AFEM drivers write their solutions.  Every `every`-th
+ *  iteration is written, and always the last iteration of an outer
+ *  iteration; with `every` 0, only the latter are.
+ *
+ *  In delta mode, a solution "name.sol" is written as "name.sol.delta",
+ *  holding only what changed since the previous solution written:
+ *
+ *    tridim tritype sol delta
+ *    <#vertices> <#lines>
+ *    <index> <vertex as in .sol>            for every new or changed vertex
+ *    <#elements> <#removed> <#lines>
+ *    <index>                                for every removed element
+ *    <index> <element as in .sol>           for every new or changed element
+ *
+ *  where elements are told apart by their index in the tree.  The manifest
+ *  lists the names of the solutions written, in order, relative to its own
+ *  directory, which has to be that of the solutions.  The first delta is
+ *  relative to an empty solution, so reconstruct() can rebuild any solution
+ *  in the manifest, byte for byte as it would have been written in full.
+ *
+ *  With `vtu`, every solution written also goes to "name.vtu" in full, for
+ *  viewing; see VTUFile.h.
+ */
+class OutputPolicy {
+public:
+  int every = 1;
+  bool delta = false;
+  bool vtu = false;
+
+  OutputPolicy(std::string manifest) : _manifest(manifest) {}
+
+  // parses "outer" or a number of iterations for `every`
+  bool parseCadence(const std::string &arg);
+
+  bool due(int iteration, bool last) const {
+    return last || (every > 0 && iteration % every == 0);
+  }
+
+  /**
+   *  Writes the solution on `p` to `filename`, or its changes in delta mode,
+   *  and to a .vtu file with the local errors of `errors` if asked to.
+   */
+  void printSolution(Partition &p, const std::string &filename, const Errors *errors = nullptr);
+
+  /**
+   *  Writes solution `name` of `manifest` to `filename`, by applying the
+   *  deltas in it up to that one.  Returns false if it is not listed.
+   */
+  static bool reconstruct(const std::string &manifest, const std::string &name,
+                          const std::string &filename);
+
+private:
+  std::string _manifest;
+  std::vector<std::string> _written;
+  std::shared_ptr<const PrintSnapshot> _last;
+};
@@ -1,107 +1,81 @@
-#include <fstream>
-
 #include "degree.h"
+#include "meshfile.h"
+#include "meshparser.h"
 #include "partition.h"
 #include "fem/rhs.h"
 
 using namespace std;
 
-std::vector<std::string> splitt(const std::string &text, char sep) {
-  std::vector<std::string> tokens;
-  std::size_t start = 0, end = 0;
-  while ((end = text.find(sep, start)) != std::string::npos) {
-    tokens.push_back(text.substr(start, end - start));
-    start = end + 1;
-  }
-  tokens.push_back(text.substr(start));
-  return tokens;
-}
-
 Partition::Partition(string basisdir, string meshfn)
   : Matchable(std::move(basisdir))
 {
-  bool reading_solution = false;
-
-  ifstream meshfile(meshfn);
-  assert(meshfile.good());
-
-  if(meshfn.compare(meshfn.size()-4, 4, ".sol") == 0) {
-    reading_solution = true;
-  }
-
-  if (reading_solution) {
-    string settingString;
-    getline(meshfile, settingString);
-    vector<string> settings = ::splitt(settingString, ' ');
-    auto it = find(settings.begin(), settings.end(), "sol");
-    assert(it != settings.end());
-  }
+  fromData(MeshFile::isBinary(meshfn) ? MeshFile(meshfn).data() : MeshParser::parse(meshfn));
+}
 
-  int nVerts, nElements;
-  meshfile >> nVerts;
-  for (auto i = 0; i < nVerts; i++) {
-    scalar x, y;
-    meshfile >> x >> y;
-    auto *vert = new Vertex(x,y);
-    if(reading_solution) {
-      bool on_boundary;
-      meshfile >> on_boundary;
-      vert->_isBoundary = on_boundary;
+/**
+ *  Creates the vertices and root elements of a .mesh or .sol file, text or
+ *  binary, see meshfile.h; for a solution, also the DOFs of its local vectors.
+ */
+void Partition::fromData(const MeshFile::Data &data) {
+  assert(data.kind != MeshFile::Rhs);
+  bool reading_solution = data.kind == MeshFile::Sol;
+
+  _verts.reserve(data.numVerts());
+  for (size_t i = 0; i < data.numVerts(); i++) {
+    auto *vert = new Vertex(data.xy[2*i], data.xy[2*i + 1]);
+    if (reading_solution) {
+      vert->_isBoundary = data.boundary[i];
     }
     addVertex(vert);
   }
 
-  meshfile >> nElements;
   ElementDimsSet current;
-  for (auto i = 0; i < nElements; i++) {
-    int ndof;
-    if (reading_solution) {
-      meshfile >> ndof;
-    }
-    int i0, i1, i2, type;
-    meshfile >> i0 >> i1 >> i2 >> type;
-    Vertex *v[3] = {_verts[i0], _verts[i1], _verts[i2]};
-    Element *root = new Element(v, &_bases.basis(type));
+  _elts.reserve(data.elts.size());
+  for (size_t i = 0; i < data.elts.size(); i++) {
+    const MeshFile::Record &r = data.elts[i];
+    Vertex *v[3] = {_verts[r.v[0]], _verts[r.v[1]], _verts[r.v[2]]};
+    Element *root = new Element(v, &_bases.basis(r.type));
     addElement(root);
     addRoot(root);
     addLeaf(root);
     if (reading_solution) {
-      current.insert(make_pair(root, ndof));
-      scalar value;
-      for (int j = 0; j < Degree::dofToDim(ndof); j++) {
-        meshfile >> value;
-      }
+      current.insert(make_pair(root, data.rows[i + 1] - data.rows[i]));
     }
   }
 
   if (reading_solution) {
     handler().determine(current);
   }
-
-  meshfile.close();
 }
 
 Partition::Partition(string basisdir, string meshfn, string rhsfn)
   : Partition(std::move(basisdir), std::move(meshfn))
 {
-  ifstream rhsfile(rhsfn);
-  assert(rhsfile.good());
-
-  int nRhsElements, nRhs;
-  rhsfile >> nRhsElements >> nRhs;
-  assert(nRhsElements == numElements());
-  assert(nRhs <= _bases.dim());
-
-  _rhs = FEM::Rhs(nRhs);
-
-  for( int i = 0; i < nRhsElements; i++) {
-    //create vector of largest size a RHS can have; initialize to zero to null
-    //out every component after nRhs
-    Vector rhs = Vector::Zero(nRhs);
-    for( int j = 0; j < nRhs; j++) {
-      rhsfile >> rhs[j];
+  if (MeshFile::isBinary(rhsfn)) {
+    MeshFile rhsfile(rhsfn);
+    assert(rhsfile.kind() == MeshFile::Rhs);
+    assert(rhsfile.numElts() == (size_t) numElements());
+    int nRhs = rhsfile.numElts() ? rhsfile.numCoeffs(0) : 0;
+    assert(nRhs <= _bases.dim());
+
+    _rhs = FEM::Rhs(nRhs);
+    for( size_t i = 0; i < rhsfile.numElts(); i++) {
+      assert(rhsfile.numCoeffs(i) == nRhs);
+      Vector rhs = Eigen::Map<const Vector>(rhsfile.coeffs(i), nRhs);
+      _rhs.insert_vector(element(i), rhs, true);
+    }
+  } else {
+    MeshFile::Data rhsfile = MeshParser::parse(rhsfn);
+    assert(rhsfile.kind == MeshFile::Rhs);
+    assert(rhsfile.numRows() == (size_t) numElements());
+    int nRhs = rhsfile.numRows() ? rhsfile.rows[1] : 0;
+    assert(nRhs <= _bases.dim());
+
+    _rhs = FEM::Rhs(nRhs);
+    for( size_t i = 0; i < rhsfile.numRows(); i++) {
+      Vector rhs = Eigen::Map<const Vector>(rhsfile.coeffs.data() + rhsfile.rows[i], nRhs);
+      _rhs.insert_vector(element(i), rhs, true);
     }
-    _rhs.insert_vector(element(i), rhs, true);
   }
 
   resetRoots();
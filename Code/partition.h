@@ -1,17 +1,41 @@
 #pragma once
 #include <iostream>
+#include <vector>
 #include "basis.h"
+#include "errors.h"
 #include "solvable.h"
 #include "matchable.h"
+#include "meshfile.h"
 
 class NearBest;
+class Checkpoint;
 
 class Partition : public Matchable {
 public:
   Partition(std::string basisdir, std::string meshfn, std::string rhsfn);
 
   friend class NearBest;
+  friend class Checkpoint;
+
+  /**
+   *  The errors of the last Refine estimate on this partition, with what
+   *  they were computed from; see ErrorEstimator::Refine.
+   */
+  struct RefineEstimate {
+    int h = -1, p = -1;
+    unsigned long revision = 0, dofRevision = 0;
+    std::vector<Vector> values;
+    Errors sqerrors;
+  };
+  RefineEstimate &lastRefineEstimate() { return _lastRefineEstimate; }
 
  protected:
   Partition(std::string basisdir, std::string meshfn);
+
+  void fromData(const MeshFile::Data &data);
+
+  // an empty partition, for Checkpoint to fill
+  Partition(std::string basisdir) : Matchable(std::move(basisdir)) {}
+
+  RefineEstimate _lastRefineEstimate;
 };
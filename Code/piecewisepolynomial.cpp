@@ -10,7 +10,7 @@ using namespace std;
 
 void PiecewisePolynomial::insert_vector(Element *elt, Vector local,
     bool definedOn) {
-  assert(l2g.count(elt) == 0);
+  assert(!has(elt));
   l2g.insert(make_pair(elt, local));
   if (definedOn) {
     _definedOn.insert(elt);
@@ -19,113 +19,238 @@ void PiecewisePolynomial::insert_vector(Element *elt, Vector local,
 }
 
 void PiecewisePolynomial::erase(Element *elt) {
-  auto it = l2g.find(elt);
-  assert(it != l2g.end());
-
   _availableOn.erase(elt);
 
   // we aren't _defined_ on all nodes that we are available on
   _definedOn.erase(elt);
+
+  auto lit = _lazy.find(elt);
+  if (lit != _lazy.end()) {
+    _lazy.erase(lit);
+    return;
+  }
+
+  auto it = l2g.find(elt);
+  assert(it != l2g.end());
+
+  // restrictions of this vector that were not computed yet would be lost
+  materializeDependents(elt, elt);
   l2g.erase(it);
 }
 
 const Vector &PiecewisePolynomial::locallyAt(Element *elt) const {
   auto it = l2g.find(elt);
-  assert(it != l2g.end());
-  return it->second;
+  if (it != l2g.end()) return it->second;
+  return materialize(elt);
+}
+
+ElementPairMap<Vector> PiecewisePolynomial::values() {
+  while (_lazy.size()) materialize(_lazy.begin()->first);
+  return l2g;
+}
+
+/**
+ *  Computes the local vector of a lazily copied element by restricting its
+ *  ancestor's vector, using cached multi-generation transfer matrices.  The
+ *  intermediate restrictions are not stored.
+ */
+const Vector &PiecewisePolynomial::materialize(Element *elt) const {
+  auto lit = _lazy.find(elt);
+  assert(lit != _lazy.end());
+  Element *ancestor = lit->second;
+
+  Vector poly = Poly::onDescendant(ancestor, elt, locallyAt(ancestor));
+
+  _lazy.erase(lit);
+  return l2g.insert(make_pair(elt, poly)).first->second;
+}
+
+void PiecewisePolynomial::materializeDependents(Element *ancestor, Element *elt) {
+  if (elt->left() == nullptr) return;
+  for (Element *child : {elt->left(), elt->right()}) {
+    if (!has(child)) continue;
+    auto lit = _lazy.find(child);
+    if (lit != _lazy.end() && lit->second == ancestor) materialize(child);
+    materializeDependents(ancestor, child);
+  }
 }
 
 void PiecewisePolynomial::copyToChildren(Element *parent) {
   assert(!parent->isLeaf());
-  Vector poly = locallyAt(parent);
 
-  Element *left = parent->left();
-  Element *right = parent->right();
+  // the ancestor whose local vector we are a restriction of
+  Element *source = parent;
+  auto lit = _lazy.find(parent);
+  if (lit != _lazy.end()) source = lit->second;
+  assert(l2g.count(source) > 0);
 
-  insert_vector(left, Poly::onChild(parent, poly, 0), false);
-  insert_vector(right, Poly::onChild(parent, poly, 1), false);
+  for (Element *child : {parent->left(), parent->right()}) {
+    assert(!has(child));
+    _lazy.insert(make_pair(child, source));
+    _availableOn.insert(child);
+  }
 }
 
-ElementSet PiecewisePolynomial::copyToRecursive(const PiecewisePolynomial &other, Element *elt) {
-  ElementSet otherIsAvailableOn;
+void PiecewisePolynomial::copyToRecursive(const PiecewisePolynomial &other, Element *elt, ElementSet &otherIsAvailableOn) {
   if (!other.has(elt)) {
     assert(!elt->isLeaf());
     // our polynomial is available on our children, skip this
     if (!has(elt->left())) {
       copyToChildren(elt);
     }
-    otherIsAvailableOn = TriangleSet::unionSets(
-        copyToRecursive(other, elt->left()), 
-        copyToRecursive(other, elt->right())
-    );
+    copyToRecursive(other, elt->left(), otherIsAvailableOn);
+    copyToRecursive(other, elt->right(), otherIsAvailableOn);
   } else {
     otherIsAvailableOn.insert(elt);
   }
-  return otherIsAvailableOn;
 }
 
 ElementSet PiecewisePolynomial::copyTo(const PiecewisePolynomial &other) {
   ElementSet otherIsAvailableOn;
   for (auto &elt : _definedOn) {
-    otherIsAvailableOn =
-        TriangleSet::unionSets(otherIsAvailableOn, copyToRecursive(other, elt));
+    copyToRecursive(other, elt, otherIsAvailableOn);
   }
 
   return otherIsAvailableOn;
 }
 
-ElementScalarSet PiecewisePolynomial::squaredH1NormsOfDifferenceWith(Element *elt, PiecewisePolynomial &other) {
-  ElementScalarSet ret;
-  ElementSet elts = copyToRecursive(other, elt);
+/**
+ *  Scratch space for the reductions.  The reductions do not nest, so one
+ *  vector per thread suffices, and it keeps its capacity between calls.
+ */
+std::vector<PiecewisePolynomial::Term> &PiecewisePolynomial::scratchTerms() {
+  static thread_local std::vector<Term> terms;
+  terms.clear();
+  return terms;
+}
+
+/**
+ *  Appends a term for each element where both `this` and `other` are
+ *  available, making `this` available on the way (like copyToRecursive).
+ *  This runs serially: it materializes local vectors, and computes the
+ *  triclass of the elements so that evaluate() only reads shared state.
+ */
+void PiecewisePolynomial::gatherDifferenceWith(const PiecewisePolynomial &other,
+    Element *elt, std::vector<Term> &terms) {
+  if (!other.has(elt)) {
+    assert(!elt->isLeaf());
+    if (!has(elt->left())) {
+      copyToChildren(elt);
+    }
+    gatherDifferenceWith(other, elt->left(), terms);
+    gatherDifferenceWith(other, elt->right(), terms);
+  } else {
+    elt->triclass();
+    terms.push_back({elt, &locallyAt(elt), &other.locallyAt(elt), 0});
+  }
+}
 
-  for (auto &elt : elts) {
+/**
+ *  Appends a term for each element below `elt` where we are available.
+ */
+void PiecewisePolynomial::gather(Element *elt, std::vector<Term> &terms) {
+  if (has(elt)) {
+    elt->triclass();
+    terms.push_back({elt, &locallyAt(elt), nullptr, 0});
+  } else {
+    assert(!elt->isLeaf());
+    gather(elt->left(), terms);
+    gather(elt->right(), terms);
+  }
+}
+
+/**
+ *  Computes the local (squared) norms of the terms in parallel.  For the
+ *  H1 norm of a difference, a term without `ours` is the norm of `theirs`.
+ */
+void PiecewisePolynomial::evaluate(Norm norm, std::vector<Term> &terms) {
+  long n = terms.size();
+#pragma omp parallel for schedule(static) if(n > 64)
+  for (long i = 0; i < n; i++) {
+    Term &term = terms[i];
+    switch (norm) {
+      case Norm::L2:
+        term.value = Poly::squaredL2Norm(term.elt, *term.ours);
+        break;
+      case Norm::H1:
+        term.value = Poly::squaredH1Norm(term.elt, *term.ours);
+        break;
+      case Norm::H1OfDifference:
+        if (term.ours == nullptr) {
+          term.value = Poly::squaredH1Norm(term.elt, *term.theirs);
+        } else {
 #if GALERKIN_ORTH
-     auto error = Poly::squaredH1Norm(elt, other.locallyAt(elt))
-                - Poly::squaredH1Norm(elt, locallyAt(elt));
+          term.value = Poly::squaredH1Norm(term.elt, *term.theirs)
+                     - Poly::squaredH1Norm(term.elt, *term.ours);
 #else
-    auto curpoly = Poly::minus(locallyAt(elt), other.locallyAt(elt));
-    auto error = Poly::squaredH1Norm(elt, curpoly);
+          term.value = Poly::squaredH1Norm(term.elt,
+                                           Poly::minus(*term.ours, *term.theirs));
 #endif
-    ret.insert(make_pair(elt, error));
+        }
+        break;
+    }
   }
+}
 
-  return ret;
+scalar PiecewisePolynomial::sum(const std::vector<Term> &terms) {
+  // the values are not contiguous, so copy them to a reused buffer first
+  static thread_local std::vector<scalar> values;
+  values.resize(terms.size());
+  for (size_t i = 0; i < terms.size(); i++) {
+    values[i] = terms[i].value;
+  }
+  return Math::pairwiseSum(values.data(), values.size());
 }
 
-ElementScalarSet PiecewisePolynomial::squaredL2Norms(Element *elt) {
+ElementScalarSet PiecewisePolynomial::asSet(const std::vector<Term> &terms) {
   ElementScalarSet ret;
-  if(has(elt)) {
-    ret.insert(make_pair(elt, Poly::squaredL2Norm(elt, locallyAt(elt))));
-  } else {
-    assert(!elt->isLeaf());
-
-    //recurse left
-    ElementScalarSet leftret = squaredL2Norms(elt->left());
-    ret.insert(leftret.begin(), leftret.end());
-
-    //recurse right
-    ElementScalarSet rightret = squaredL2Norms(elt->right());
-    ret.insert(rightret.begin(), rightret.end());
+  for (auto &term : terms) {
+    ret.insert(ret.end(), make_pair(term.elt, term.value));
   }
   return ret;
 }
 
-ElementScalarSet PiecewisePolynomial::squaredH1Norms(Element *elt) {
-  ElementScalarSet ret;
-  if(has(elt)) {
-    ret.insert(make_pair(elt, Poly::squaredH1Norm(elt, locallyAt(elt))));
-  } else {
-    assert(!elt->isLeaf());
+void PiecewisePolynomial::gatherDifferenceWith(PiecewisePolynomial &other,
+    std::vector<Term> &terms) {
+  for (auto &elt : _definedOn) {
+    gatherDifferenceWith(other, elt, terms);
+  }
 
-    //recurse left
-    ElementScalarSet leftret = squaredH1Norms(elt->left());
-    ret.insert(leftret.begin(), leftret.end());
+  // if we are defined nowhere, the difference is `other` itself
+  if (terms.empty()) {
+    for (auto &elt : other.definedOn()) {
+      elt->triclass();
+      terms.push_back({elt, nullptr, &other.locallyAt(elt), 0});
+    }
+  }
+}
 
-    //recurse right
-    ElementScalarSet rightret = squaredH1Norms(elt->right());
-    ret.insert(rightret.begin(), rightret.end());
+void PiecewisePolynomial::gatherDefinedOn(std::vector<Term> &terms) {
+  for (auto &elt : _definedOn) {
+    elt->triclass();
+    terms.push_back({elt, &locallyAt(elt), nullptr, 0});
   }
-  return ret;
+}
+
+ElementScalarSet PiecewisePolynomial::squaredH1NormsOfDifferenceWith(Element *elt, PiecewisePolynomial &other) {
+  auto &terms = scratchTerms();
+  gatherDifferenceWith(other, elt, terms);
+  evaluate(Norm::H1OfDifference, terms);
+  return asSet(terms);
+}
+
+ElementScalarSet PiecewisePolynomial::squaredL2Norms(Element *elt) {
+  auto &terms = scratchTerms();
+  gather(elt, terms);
+  evaluate(Norm::L2, terms);
+  return asSet(terms);
+}
+
+ElementScalarSet PiecewisePolynomial::squaredH1Norms(Element *elt) {
+  auto &terms = scratchTerms();
+  gather(elt, terms);
+  evaluate(Norm::H1, terms);
+  return asSet(terms);
 }
 
 scalar PiecewisePolynomial::squaredH1NormOfDifferenceWith(Element *elt,
@@ -133,123 +258,105 @@ scalar PiecewisePolynomial::squaredH1NormOfDifferenceWith(Element *elt,
 #if GALERKIN_ORTH
   return other.squaredH1Norm(elt) - squaredH1Norm(elt);
 #else
-  scalar res = 0;
-  for (auto &child : squaredH1NormsOfDifferenceWith(elt, other)) {
-    res += child.second;
-  }
-  return res;
+  auto &terms = scratchTerms();
+  gatherDifferenceWith(other, elt, terms);
+  evaluate(Norm::H1OfDifference, terms);
+  return sum(terms);
 #endif
 }
 
 scalar PiecewisePolynomial::squaredL2Norm(Element *elt) {
-  scalar res = 0;
-  for (auto &child : squaredL2Norms(elt)) {
-    res += child.second;
-  }
-  return res;
+  auto &terms = scratchTerms();
+  gather(elt, terms);
+  evaluate(Norm::L2, terms);
+  return sum(terms);
 }
 
 scalar PiecewisePolynomial::squaredH1Norm(Element *elt) {
-  scalar res = 0;
-  for (auto &child : squaredH1Norms(elt)) {
-    res += child.second;
-  }
-  return res;
+  auto &terms = scratchTerms();
+  gather(elt, terms);
+  evaluate(Norm::H1, terms);
+  return sum(terms);
 }
 
 
 
 ElementScalarSet PiecewisePolynomial::squaredH1NormsOfDifferenceWith(PiecewisePolynomial &other) {
-  ElementScalarSet ret;
-  ElementSet elts = copyTo(other);
-  if (elts.size()) {
-    // compute the error on this approximation
-
-    for (auto &child : elts) {
-#if GALERKIN_ORTH
-       auto error = Poly::squaredH1Norm(child, other.locallyAt(child))
-                  - Poly::squaredH1Norm(child, locallyAt(child));
-#else
-      auto curpoly = Poly::minus(locallyAt(child), other.locallyAt(child));
-      auto error = Poly::squaredH1Norm(child, curpoly);
-#endif
-      ret.insert(make_pair(child, error));
-    }
-  } else {
-    for (auto &child : other.definedOn()) {
-      ret.insert(make_pair(child, Poly::squaredH1Norm(child,
-                                                      other.locallyAt(child))));
-    }
-  }
-
-  return ret;
+  auto &terms = scratchTerms();
+  gatherDifferenceWith(other, terms);
+  evaluate(Norm::H1OfDifference, terms);
+  return asSet(terms);
 }
 
 ElementScalarSet PiecewisePolynomial::squaredL2Norms() {
-  ElementScalarSet ret;
-  for (auto &child : _definedOn) {
-    auto curnorm = Poly::squaredL2Norm(child, locallyAt(child));
-    ret.insert(make_pair(child, curnorm));
-  }
-  return ret;
+  auto &terms = scratchTerms();
+  gatherDefinedOn(terms);
+  evaluate(Norm::L2, terms);
+  return asSet(terms);
 }
 
 ElementScalarSet PiecewisePolynomial::squaredH1Norms() {
-  ElementScalarSet ret;
-  for (auto &child : _definedOn) {
-    ret.insert(make_pair(child, Poly::squaredH1Norm(child, locallyAt(child))));
-  }
-  return ret;
+  auto &terms = scratchTerms();
+  gatherDefinedOn(terms);
+  evaluate(Norm::H1, terms);
+  return asSet(terms);
 }
 
 scalar PiecewisePolynomial::squaredH1NormOfDifferenceWith(PiecewisePolynomial &other) {
 #if GALERKIN_ORTH
   return other.squaredH1Norm() - squaredH1Norm();
 #else
-  scalar res = 0;
-  for (auto &child : squaredH1NormsOfDifferenceWith(other)) {
-    res += child.second;
-  }
-  return res;
+  auto &terms = scratchTerms();
+  gatherDifferenceWith(other, terms);
+  evaluate(Norm::H1OfDifference, terms);
+  return sum(terms);
 #endif
 }
 
 scalar PiecewisePolynomial::squaredL2Norm() {
-  scalar res = 0;
-  for( auto &child : squaredL2Norms()) res += child.second;
-  return res;
+  auto &terms = scratchTerms();
+  gatherDefinedOn(terms);
+  evaluate(Norm::L2, terms);
+  return sum(terms);
 }
 
 scalar PiecewisePolynomial::squaredH1Norm() {
-  scalar res = 0;
-  for( auto &child : squaredH1Norms()) res += child.second;
-  return res;
+  auto &terms = scratchTerms();
+  gatherDefinedOn(terms);
+  evaluate(Norm::H1, terms);
+  return sum(terms);
 }
 
+// the values are read back, so they are written such that they read back exactly
 ostream &PiecewisePolynomial::printForFile(const ElementSet &on, ostream &os) {
-  os << Print::formatted("%lu %d", on.size(), maximum_dim(on)) << endl;
+  Formatter f(os);
+  f << on.size() << ' ' << maximum_dim(on) << '\n';
   for (auto &elt : on) {
-    Vector vec = locallyAt(elt);
+    const Vector &vec = locallyAt(elt);
     for (int i = 0; i < vec.rows(); i++) {
-      if (i > 0) os << " ";
-      os << Print::formatted("%.30Lf", (long double) vec[i]);
+      if (i > 0) f << ' ';
+      f.shortest((long double) vec[i]);
     }
-    os << endl;
+    f << '\n';
   }
+  f.flush();
 
   return os;
 }
 
 ostream &PiecewisePolynomial::print(const ElementSet &on, ostream &os) {
-  os << Print::formatted("%lu", on.size()) << endl;
+  Formatter f(os);
+  f << on.size() << '\n';
   for (auto &elt : on) {
-    Vector vec = locallyAt(elt);
-    os << Print::formatted("%lu %d %d %d %d", vec.rows(), elt->i(0), elt->i(1), elt->i(2), elt->type().toInt());
+    const Vector &vec = locallyAt(elt);
+    f << vec.rows() << ' ' << elt->i(0) << ' ' << elt->i(1) << ' ' << elt->i(2) << ' ' << elt->type().toInt();
     for (int i = 0; i < vec.rows(); i++) {
-      os << Print::formatted(" %.16f", (double) vec[i]);
+      f << ' ';
+      f.fixed((double) vec[i], 16);
     }
-    os << endl;
+    f << '\n';
   }
+  f.flush();
 
   return os;
 }
@@ -1,11 +1,14 @@
 #pragma once
 #include <map>
+#include <vector>
 #include <fstream>
 #include <iostream>
 
 #include "triangleset.h"
 #include "element.h"
 
+class Checkpoint;
+
 class PiecewisePolynomial {
 public:
   virtual void insert_vector(Element *elt, Vector local, bool definedOn);
@@ -14,13 +17,23 @@ public:
 
   const ElementSet &definedOn() const { return _definedOn; }
   const ElementSet &availableOn() const { return _availableOn; }
+
+  /**
+   *  Makes this polynomial available on the children of `parent`.  This is
+   *  lazy: the children only remember the ancestor whose local vector they
+   *  are a restriction of, and Poly::onChild is applied on the first call to
+   *  locallyAt().  Because of this, locallyAt() may modify internal state and
+   *  is not safe to call concurrently.
+   */
   void copyToChildren(Element *parent);
 
-  bool has(Element *elt) const { return l2g.count(elt) > 0; }
-  ElementPairMap<Vector> values() { return l2g; }
+  bool has(Element *elt) const { return l2g.count(elt) > 0 || _lazy.count(elt) > 0; }
+  ElementPairMap<Vector> values();
 
   virtual int local_dim(Element *elt) {
     assert(has(elt));
+    auto it = _lazy.find(elt);
+    if (it != _lazy.end()) elt = it->second;
     return l2g.find(elt)->second.rows();
   }
 
@@ -40,6 +53,14 @@ public:
    */
   ElementSet copyTo(const PiecewisePolynomial &other);
 
+  /**
+   *  The norms below stream over the elements without building intermediate
+   *  sets.  The local norms are computed in parallel and summed pairwise, in
+   *  element order, so the result does not depend on the number of threads.
+   *  The ElementScalarSet variants are only for callers that need the local
+   *  values, like the error estimators.
+   */
+
   // compute the norm of this polynomial on a specific triangle
   ElementScalarSet squaredH1NormsOfDifferenceWith(Element *elt, PiecewisePolynomial &other);
   ElementScalarSet squaredL2Norms(Element *elt);
@@ -67,13 +88,39 @@ public:
   std::ostream &printForFile(const ElementSet &on, std::ostream &os = std::cout);
 
 protected:
-  /* local to global converter */
-  ElementPairMap<Vector> l2g;
+  /* local to global converter; filled in for restrictions on first access */
+  mutable ElementPairMap<Vector> l2g;
+
+  /* restrictions that have not been computed yet, and the ancestor in l2g
+   * that they are a restriction of */
+  mutable ElementPairMap<Element *> _lazy;
+
+  const Vector &materialize(Element *elt) const;
+  void materializeDependents(Element *ancestor, Element *elt);
 
   /* set of elements we are defined on */
   ElementSet _definedOn;
 
   ElementSet _availableOn;
 
-  ElementSet copyToRecursive(const PiecewisePolynomial &other, Element *elt);
+  friend class Checkpoint;
+
+  void copyToRecursive(const PiecewisePolynomial &other, Element *elt, ElementSet &otherIsAvailableOn);
+
+  /* a local term of one of the norms above */
+  struct Term {
+    Element *elt;
+    const Vector *ours, *theirs;
+    scalar value;
+  };
+  enum class Norm { L2, H1, H1OfDifference };
+
+  void gatherDifferenceWith(const PiecewisePolynomial &other, Element *elt, std::vector<Term> &terms);
+  void gatherDifferenceWith(PiecewisePolynomial &other, std::vector<Term> &terms);
+  void gather(Element *elt, std::vector<Term> &terms);
+  void gatherDefinedOn(std::vector<Term> &terms);
+  static void evaluate(Norm norm, std::vector<Term> &terms);
+  static scalar sum(const std::vector<Term> &terms);
+  static ElementScalarSet asSet(const std::vector<Term> &terms);
+  static std::vector<Term> &scratchTerms();
 };
@@ -0,0 +1,146 @@
+#include <algorithm>
+#include <array>
+#include <cassert>
+#include <cmath>
+#include <limits>
+#include <map>
+
+#include "basisevaluator.h"
+#include "element.h"
+#include "piecewisepolynomial.h"
+#include "pointlocator.h"
+
+using namespace std;
+
+namespace {
+// points on edges may be off by rounding; anything further out is outside
+const scalar tolerance = 1e-12;
+
+// how deep (x, y) lies in elt: the smallest of its barycentric coordinates
+scalar depth(const Element *elt, scalar x, scalar y, scalar lambda[3]) {
+  elt->barycentric(x, y, lambda);
+  return min(lambda[0], min(lambda[1], lambda[2]));
+}
+}
+
+PointLocator::PointLocator(const ElementSet &roots) : _roots(roots.begin(), roots.end()) {
+  assert(!_roots.empty());
+  scalar x1 = -numeric_limits<scalar>::infinity(), y1 = x1;
+  _x0 = _y0 = numeric_limits<scalar>::infinity();
+  for( Element *root : _roots) {
+    for( int k = 0; k < 3; k++) {
+      _x0 = min(_x0, root->v(k)->x);
+      _y0 = min(_y0, root->v(k)->y);
+      x1 = max(x1, root->v(k)->x);
+      y1 = max(y1, root->v(k)->y);
+    }
+  }
+
+  // square buckets of a quarter of the mean area of the roots, so that
+  // every bucket overlaps only a few of them
+  scalar w = x1 - _x0, h = y1 - _y0, side = sqrt(w*h/_roots.size())/2;
+  _nx = max(1, (int) ceil(w/side));
+  _ny = max(1, (int) ceil(h/side));
+  _dx = w/_nx;
+  _dy = h/_ny;
+
+  // the buckets overlapping the bounding box of every root, counted first
+  vector<array<int, 4>> ranges(_roots.size());
+  _buckets.assign(_nx*_ny + 1, 0);
+  for( size_t r = 0; r < _roots.size(); r++) {
+    scalar bx0 = x1, by0 = y1, bx1 = _x0, by1 = _y0;
+    for( int k = 0; k < 3; k++) {
+      bx0 = min(bx0, _roots[r]->v(k)->x);
+      by0 = min(by0, _roots[r]->v(k)->y);
+      bx1 = max(bx1, _roots[r]->v(k)->x);
+      by1 = max(by1, _roots[r]->v(k)->y);
+    }
+    auto cell = [](scalar t, scalar t0, scalar dt, int n) { return min(n - 1, max(0, (int) floor((t - t0)/dt))); };
+    ranges[r] = {{cell(bx0, _x0, _dx, _nx), cell(bx1, _x0, _dx, _nx), cell(by0, _y0, _dy, _ny), cell(by1, _y0, _dy, _ny)}};
+    for( int j = ranges[r][2]; j <= ranges[r][3]; j++) {
+      for( int i = ranges[r][0]; i <= ranges[r][1]; i++) _buckets[j*_nx + i + 1]++;
+    }
+  }
+  for( int c = 0; c < _nx*_ny; c++) _buckets[c + 1] += _buckets[c];
+
+  vector<int> next(_buckets.begin(), _buckets.end() - 1);
+  _bucketed.resize(_buckets.back());
+  for( size_t r = 0; r < _roots.size(); r++) {
+    for( int j = ranges[r][2]; j <= ranges[r][3]; j++) {
+      for( int i = ranges[r][0]; i <= ranges[r][1]; i++) _bucketed[next[j*_nx + i]++] = r;
+    }
+  }
+}
+
+PointLocator::Location PointLocator::locate(scalar x, scalar y) const {
+  Location loc;
+  scalar tx = (x - _x0)/_dx, ty = (y - _y0)/_dy;
+  if( !(tx >= -tolerance && tx <= _nx + tolerance && ty >= -tolerance && ty <= _ny + tolerance)) return loc;
+  int c = min(_ny - 1, max(0, (int) ty))*_nx + min(_nx - 1, max(0, (int) tx));
+
+  // the root the point is deepest in
+  scalar best = -tolerance, lambda[3];
+  for( int b = _buckets[c]; b < _buckets[c + 1]; b++) {
+    Element *root = _roots[_bucketed[b]];
+    scalar d = depth(root, x, y, lambda);
+    if( d >= best) {
+      best = d;
+      loc.elt = root;
+      copy(lambda, lambda + 3, loc.lambda);
+    }
+  }
+  if( loc.elt == nullptr) return loc;
+
+  // the point lies in the parent, so it lies in one of the children
+  while( !loc.elt->isLeaf()) {
+    Element *left = loc.elt->left(), *right = loc.elt->right();
+    scalar l[3], r[3];
+    if( depth(left, x, y, l) >= depth(right, x, y, r)) {
+      loc.elt = left;
+      copy(l, l + 3, loc.lambda);
+    } else {
+      loc.elt = right;
+      copy(r, r + 3, loc.lambda);
+    }
+  }
+  return loc;
+}
+
+void PointLocator::locate(const Vector &x, const Vector &y, vector<Location> &out) const {
+  assert(x.rows() == y.rows());
+  out.resize(x.rows());
+#pragma omp parallel for schedule(static)
+  for( int q = 0; q < x.rows(); q++) out[q] = locate(x[q], y[q]);
+}
+
+void PointLocator::evaluate(const PiecewisePolynomial &u, const BasisEvaluator &evaluator,
+                            const vector<Location> &locs, Vector &values) {
+  values.setConstant(locs.size(), numeric_limits<scalar>::quiet_NaN());
+
+  // the points in every leaf; locallyAt is not thread safe, so it is called here
+  map<Element *, vector<int>> points;
+  for( size_t q = 0; q < locs.size(); q++) {
+    if( locs[q].elt) points[locs[q].elt].push_back(q);
+  }
+  vector<pair<const Vector *, const vector<int> *>> todo;
+  vector<Element *> elts;
+  for( auto &p : points) {
+    todo.push_back(make_pair(&u.locallyAt(p.first), &p.second));
+    elts.push_back(p.first);
+  }
+
+#pragma omp parallel for schedule(dynamic, 16)
+  for( size_t t = 0; t < todo.size(); t++) {
+    const Vector &local = *todo[t].first;
+    const vector<int> &qs = *todo[t].second;
+    Vector x(qs.size()), y(qs.size());
+    for( size_t k = 0; k < qs.size(); k++) {
+      x[k] = locs[qs[k]].lambda[1];
+      y[k] = locs[qs[k]].lambda[2];
+    }
+    Matrix phi;
+    evaluator.evaluate(elts[t]->type(), x, y, local.rows(), phi);
+    Vector v = phi * local;
+    for( size_t k = 0; k < qs.size(); k++) values[qs[k]] = v[k];
+  }
+}
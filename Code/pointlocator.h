@@ -0,0 +1,56 @@
+#pragma once
+
+#include <vector>
+
+#include "config.h"
+#include "matrix.h"
+#include "triangleset.h"
+
+class BasisEvaluator;
+class Element;
+class PiecewisePolynomial;
+
+/**
+ *  PointLocator.h
+ *
+ *  Finds the leaves containing given points.  The roots are put in a uniform
+ *  grid of buckets over their bounding box, a few buckets per root, so
+ *  a point is only tested against the few roots overlapping its bucket.
+ *  From the root containing it, we descend the bisection tree to the leaf,
+ *  going to the child the point is deepest in at every step.
+ *
+ *  Only the roots are indexed, so the locator stays valid while the
+ *  partition is refined or coarsened, as long as the roots stay the same.
+ *  Locating does not modify anything, so batches are located in parallel.
+ */
+class PointLocator {
+public:
+  // a leaf, and the barycentric coordinates of the point with respect to
+  // its vertices; elt is null for points outside the domain
+  struct Location {
+    Element *elt = nullptr;
+    scalar lambda[3] = {0, 0, 0};
+  };
+
+  PointLocator(const ElementSet &roots);
+
+  Location locate(scalar x, scalar y) const;
+  void locate(const Vector &x, const Vector &y, std::vector<Location> &out) const;
+
+  /**
+   *  The values of `u` at the located points, NaN outside the domain.  The
+   *  point with barycentric coordinates lambda is (lambda[1], lambda[2]) on
+   *  the reference triangle of the BasisEvaluator.
+   */
+  static void evaluate(const PiecewisePolynomial &u, const BasisEvaluator &evaluator,
+                       const std::vector<Location> &locs, Vector &values);
+
+private:
+  std::vector<Element *> _roots;
+
+  // the bounding box of the roots, and the buckets of roots overlapping
+  // each cell: bucket c holds _bucketed[_buckets[c]], ..., _bucketed[_buckets[c+1]-1]
+  scalar _x0, _y0, _dx, _dy;
+  int _nx, _ny;
+  std::vector<int> _buckets, _bucketed;
+};
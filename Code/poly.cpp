@@ -11,6 +11,30 @@ Vector Poly::onChild(Element *elt, const Vector &v, bool rightChild) {
   return res;
 }
 
+Vector Poly::onDescendant(Element *ancestor, Element *elt, const Vector &v) {
+  // the sides taken from elt up to ancestor
+  vector<Element *> path;
+  for( Element *cur = elt; cur != ancestor; cur = cur->parent()) {
+    assert(!cur->isRoot());
+    path.push_back(cur);
+  }
+
+  Vector res = v;
+  Element *cur = ancestor;
+  while( path.size()) {
+    int generations = min((int) path.size(), (int) Bases::MaxTransferGenerations);
+    unsigned sides = 0;
+    Element *child = cur;
+    for( int gen = 0; gen < generations; gen++) {
+      child = path.back(); path.pop_back();
+      sides |= (unsigned) (child->parent()->right() == child) << gen;
+    }
+    res = cur->transfer(sides, generations, res);
+    cur = child;
+  }
+  return res;
+}
+
 Vector Poly::minus(const Vector &v1, const Vector &v2) {
   int vl = v1.rows(), ol = v2.rows();
   Vector res = Vector::Zero(max(vl, ol));
@@ -40,6 +40,14 @@ public:
    */
   static Vector onChild(Element *elt, const Vector &v, bool rightChild);
 
+  /**
+   *  Same as onChild, but restricts `v` from `ancestor` to its descendant 
+   *  `elt`.  The path is handled in chunks of Bases::MaxTransferGenerations
+   *  generations, each of which becomes a single product once it is used
+   *  often (see Bases::transfer).
+   */
+  static Vector onDescendant(Element *ancestor, Element *elt, const Vector &v);
+
   /**
    * Simple method to find the difference of two Vectors that are not necessarily
    * of the same length.
@@ -1,14 +1,113 @@
-#include <cstdio>
-#include <string>
-#include <cassert>
+#include <charconv>
+#include <cstring>
+#include <limits>
+
 #include "print.h"
 
 using namespace std;
 
-template< typename... Args >
-string Print::formatted( const string &format, Args... args ) {
-  size_t size = 1 + snprintf(nullptr, 0, format.c_str(), args ...);
-  unique_ptr<char[]> buf(new char[size]);
-  snprintf(buf.get(), size, format.c_str(), args ...);
-  return string(buf.get(), buf.get() + size);
+namespace {
+// the most characters a number needs with `precision` digits after the point
+template<typename T>
+size_t maxChars(int precision) {
+  return numeric_limits<T>::max_exponent10 + precision + 8;
+}
+}
+
+template<typename... Args>
+Formatter &Formatter::toChars(size_t n, Args... args) {
+  char *p = reserve(n);
+  auto result = to_chars(p, _buf.data() + _buf.size(), args ...);
+  assert(result.ec == errc());
+  _end = result.ptr - _buf.data();
+  return *this;
+}
+
+template<typename... Args>
+Formatter &Formatter::printf(const char *format, Args... args) {
+  size_t size = snprintf(nullptr, 0, format, args ...);
+  snprintf(reserve(size + 1), size + 1, format, args ...);
+  _end += size;
+  return *this;
+}
+
+Formatter &Formatter::operator<<(const char *s) {
+  size_t n = strlen(s);
+  memcpy(reserve(n), s, n);
+  _end += n;
+  return *this;
+}
+
+Formatter &Formatter::operator<<(const string &s) {
+  memcpy(reserve(s.size()), s.data(), s.size());
+  _end += s.size();
+  return *this;
+}
+
+Formatter &Formatter::integer(long long value) {
+  return toChars(24, value);
+}
+
+#ifdef __cpp_lib_to_chars
+Formatter &Formatter::fixed(double value, int precision) {
+  return toChars(maxChars<double>(precision), value, chars_format::fixed, precision);
+}
+
+Formatter &Formatter::fixed(long double value, int precision) {
+  return toChars(maxChars<long double>(precision), value, chars_format::fixed, precision);
+}
+
+Formatter &Formatter::shortest(double value) {
+  return toChars(32, value);
+}
+
+Formatter &Formatter::shortest(long double value) {
+  return toChars(48, value);
+}
+
+Formatter &Formatter::general(double value) {
+  return toChars(32, value, chars_format::general, 6);
+}
+
+Formatter &Formatter::general(long double value) {
+  return toChars(32, value, chars_format::general, 6);
+}
+#else
+Formatter &Formatter::fixed(double value, int precision) {
+  return printf("%.*f", precision, value);
+}
+
+Formatter &Formatter::fixed(long double value, int precision) {
+  return printf("%.*Lf", precision, value);
+}
+
+// enough digits to tell all values apart, if not the fewest
+Formatter &Formatter::shortest(double value) {
+  return printf("%.17g", value);
+}
+
+Formatter &Formatter::shortest(long double value) {
+  return printf("%.21Lg", value);
+}
+
+Formatter &Formatter::general(double value) {
+  return printf("%g", value);
+}
+
+Formatter &Formatter::general(long double value) {
+  return printf("%Lg", value);
+}
+#endif
+
+char *Formatter::reserve(size_t n) {
+  if( _end + n > _buf.size()) {
+    flush();
+    if( n > _buf.size()) _buf.resize(n);
+  }
+  return _buf.data() + _end;
+}
+
+void Formatter::flush() {
+  _os.write(_buf.data(), _end);
+  _end = 0;
 }
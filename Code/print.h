@@ -1,16 +1,82 @@
 #pragma GCC diagnostic ignored "-Wformat"
+#pragma once
 #include <cstdio>
+#include <memory>
 #include <string>
 #include <cassert>
 #include <ostream>
+#include <type_traits>
+#include <vector>
 
 class Print {
 public:
+  // formats into a buffer on the stack, and only allocates when it is too small
   template<typename... Args>
   static std::string formatted(const std::string &format, Args... args) {
-    size_t size = 1 + std::snprintf(nullptr, 0, format.c_str(), args ...);
-    std::unique_ptr<char[]> buf(new char[size]);
-    std::snprintf(buf.get(), size, format.c_str(), args ...);
-    return std::string(buf.get(), buf.get() + size-1);
+    char buf[256];
+    size_t size = std::snprintf(buf, sizeof(buf), format.c_str(), args ...);
+    if( size < sizeof(buf)) return std::string(buf, size);
+
+    std::unique_ptr<char[]> big(new char[size + 1]);
+    std::snprintf(big.get(), size + 1, format.c_str(), args ...);
+    return std::string(big.get(), size);
   }
 };
+
+/**
+ *  Text output of numbers for the printers.  Numbers are converted with
+ *  std::to_chars, straight into a buffer that is reused for the whole
+ *  output and handed to the stream in large blocks, instead of going
+ *  through Print::formatted per value.
+ *
+ *  fixed() writes exactly what printf's "%.<precision>f" writes, so the
+ *  output files keep their format; shortest() writes the shortest text that
+ *  reads back as the same value, for files that are read back.  Where the
+ *  standard library cannot convert floating point numbers, they fall back to
+ *  snprintf, with enough digits for long doubles.
+ *
+ *  The output is written when the Formatter is flushed or destroyed.
+ */
+class Formatter {
+public:
+  Formatter(std::ostream &os) : _os(os) { _buf.resize(BlockSize); }
+  ~Formatter() { flush(); }
+  Formatter(const Formatter &) = delete;
+  Formatter &operator=(const Formatter &) = delete;
+
+  Formatter &operator<<(const char *s);
+  Formatter &operator<<(const std::string &s);
+  Formatter &operator<<(char c) {
+    *reserve(1) = c;
+    _end++;
+    return *this;
+  }
+  template<typename T, typename = typename std::enable_if<std::is_integral<T>::value>::type>
+  Formatter &operator<<(T value) { return integer((long long) value); }
+
+  Formatter &fixed(double value, int precision);
+  Formatter &fixed(long double value, int precision);
+  Formatter &shortest(double value);
+  Formatter &shortest(long double value);
+  // as printf's "%g"
+  Formatter &general(double value);
+  Formatter &general(long double value);
+
+  void flush();
+
+private:
+  static const size_t BlockSize = 1 << 16;
+
+  std::ostream &_os;
+  std::vector<char> _buf;
+  size_t _end = 0;
+
+  // room for n more characters, flushing first if the block is full
+  char *reserve(size_t n);
+  Formatter &integer(long long value);
+  // to_chars(..., args), for at most n characters
+  template<typename... Args>
+  Formatter &toChars(size_t n, Args... args);
+  template<typename... Args>
+  Formatter &printf(const char *format, Args... args);
+};
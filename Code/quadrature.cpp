@@ -0,0 +1,50 @@
+#include <cassert>
+#include <cmath>
+
+#include "quadrature.h"
+
+using namespace std;
+
+vector<Quadrature::Point> Quadrature::gauss(int n) {
+  assert(n > 0);
+  const scalar pi = acos((scalar) -1);
+  vector<Point> pts(n);
+  for( int i = 0; i < n; i++) {
+    // Newton iteration for the i-th root of P_n on [-1,1]
+    scalar z = cos(pi * (i + 0.75L) / (n + 0.5L)), dp = 0;
+    for( int it = 0; it < 100; it++) {
+      scalar p0 = 1, p1 = z;
+      for( int k = 2; k <= n; k++) {
+        scalar p2 = ((2*k - 1) * z * p1 - (k - 1) * p0) / k;
+        p0 = p1; p1 = p2;
+      }
+      dp = n * (z * p1 - p0) / (z*z - 1);
+      scalar dz = p1 / dp;
+      z -= dz;
+      if( fabs(dz) < 1e-19L) break;
+    }
+    pts[i].x = (1 - z) / 2;
+    pts[i].y = 0;
+    pts[i].w = 1 / ((1 - z*z) * dp * dp);
+  }
+  return pts;
+}
+
+vector<Quadrature::Point> Quadrature::line(int degree) {
+  return gauss(max(1, (degree + 2) / 2));
+}
+
+vector<Quadrature::Point> Quadrature::triangle(int degree) {
+  // (x, y) = (s, t(1-s)) has Jacobian 1-s, which adds a degree in s
+  auto s = gauss(max(1, (degree + 3) / 2));
+  auto t = line(degree);
+
+  vector<Point> pts;
+  pts.reserve(s.size() * t.size());
+  for( auto &ps : s) {
+    for( auto &pt : t) {
+      pts.push_back({ps.x, pt.x * (1 - ps.x), ps.w * pt.w * (1 - ps.x)});
+    }
+  }
+  return pts;
+}
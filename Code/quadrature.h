@@ -0,0 +1,27 @@
+#pragma once
+
+#include <vector>
+
+#include "config.h"
+
+/**
+ *  Quadrature rules on the unit interval and the reference triangle (0,0),
+ *  (1,0), (0,1).  The triangle rules are collapsed Gauss rules: a tensor
+ *  product rule on the square mapped onto the triangle.  They are not the
+ *  most economic rules, but they exist for any degree.
+ */
+class Quadrature {
+public:
+  struct Point {
+    scalar x, y, w;
+  };
+
+  // Gauss-Legendre rule on [0,1] with n points, exact for degree 2n-1
+  static std::vector<Point> gauss(int n);
+
+  // rule on [0,1] (in x; y is 0) exact for polynomials of degree `degree`
+  static std::vector<Point> line(int degree);
+
+  // rule on the reference triangle exact for polynomials of degree `degree`
+  static std::vector<Point> triangle(int degree);
+};
@@ -2,10 +2,13 @@
 
 #include <fstream>
 #include <vector>
-#include <algorithm>
 #include <ctime>
 
+#include "asyncwriter.h"
+#include "budget.h"
 #include "errorestimator/base.h"
+#include "marking.h"
+#include "outputpolicy.h"
 #include "fem/solution.h"
 #include "partition.h"
 
@@ -18,9 +21,18 @@ private:
   scalar _delta;
   scalar _theta;
   scalar _error = -1.;
+  // if positive, solve up to this fraction of the last error estimate
+  scalar _solveFraction;
+  // if given, we stop early when a budget is exceeded
+  Budget *_budget;
+  // if given, decides which solutions are written and how
+  OutputPolicy *_output;
   static int _i;
 
 public:
+  // the number of calls so far, which numbers the output; set on resuming
+  static void setCount(int i) { _i = i; }
+
   Reduce(Partition &partition, FEM::Solution &sol, scalar delta, scalar theta) :
     Reduce(partition, sol, delta, theta, false) {}
 
@@ -29,8 +41,10 @@ public:
         std::ofstream("output/testLshaped_" + std::to_string(theta) + "_" + scalarname + ".errlog", std::ios_base::app))
   {}
 
-  Reduce(Partition &partition, FEM::Solution &sol, scalar delta, scalar theta, bool print_rhs, std::ostream& os) :
-    _partition(partition), _sol(sol), _delta(delta), _theta(theta) 
+  Reduce(Partition &partition, FEM::Solution &sol, scalar delta, scalar theta, bool print_rhs, std::ostream& os,
+         scalar solve_fraction = 0, Budget *budget = nullptr, OutputPolicy *output = nullptr) :
+    _partition(partition), _sol(sol), _delta(delta), _theta(theta), _solveFraction(solve_fraction),
+    _budget(budget), _output(output)
   {
     using namespace std;
     cerr << "In Reduce with delta=" << delta << " and theta=" << theta << endl;
@@ -38,50 +52,63 @@ public:
     int j = 0;
     while(true) {
       _partition.handler().redetermineOn(_partition.leaves());
-      _partition.solve();
+
+      // an algebraic error far below the discretization error is wasted, so
+      // solve up to a fraction of the last estimate (or of delta, before we
+      // have one), warm-starting from the last solution
+      int iterations = 0;
+      scalar algebraic = 0;
+      if (_solveFraction > 0) {
+        auto solver = _partition.solve(_solveFraction * (_error > 0 ? _error : delta));
+        iterations = solver->iterations();
+        algebraic = solver->algebraicError();
+      } else {
+        _partition.solve();
+      }
 
       // instantiate the error estimator
       E err = E(_partition, _sol);
       _error = err.error();
 
-      // compute the local error on each element and store in a vector
-      Errors errors = err.sqerrors();
-      std::vector<std::pair<scalar, Element *>> errvec;
-      for( auto const p : errors.on(_partition.leaves())) {
-        errvec.push_back(make_pair(p.second, p.first));
-      }
-
-      // sort this vector by error in descending order
-      std::sort(errvec.begin(), errvec.end());
-      std::reverse(errvec.begin(), errvec.end());
-
       // produce some logs
       cerr << "\tError was: " << _error << "; needed " << _delta << endl;
       int numdofs = _partition.handler().recomputeNumDOFs();
       os << "0 " << time(nullptr) << ": " << _i << " " << j << " " << numdofs << " " << _error << endl;
-      string solfile = Print::formatted("output/testLshaped_%d.%d_%d.sol", _i, j++, numdofs);
-      cerr << "\t sol: " << solfile << endl;
-      _partition.printSolution(solfile);
-      if (print_rhs) {
-        string rhsfile = Print::formatted("output/testLshaped_%d.%d_%d.sol", _i, j-1, numdofs);
-        ofstream os(rhsfile, ofstream::trunc);
-        _partition.rhs().printForFile(_partition.leaves(), os);
-        os.flush();
-        os.close();
+      if (_solveFraction > 0) {
+        os << "5 " << iterations << " " << algebraic << " " << _error << endl;
+      }
+      // this is the last iteration if we are small enough, or if refining
+      // would exceed our budget
+      bool done = _error <= delta;
+      bool exceeded = !done && _budget && _budget->exceeded(numdofs);
+      Errors errors = err.sqerrors();
+
+      if (!_output || _output->due(j, done || exceeded)) {
+        string solfile = Print::formatted("output/testLshaped_%d.%d_%d.sol", _i, j, numdofs);
+        cerr << "\t sol: " << solfile << endl;
+        if (_output) _output->printSolution(_partition, solfile, &errors);
+        else _partition.printSolution(solfile);
+        if (print_rhs) {
+          // the rhs replaces the solution, so it has to be written after it
+          AsyncWriter::instance().flush();
+          ofstream os(solfile, ofstream::trunc);
+          _partition.rhs().printForFile(_partition.leaves(), os);
+          os.flush();
+          os.close();
+        }
       }
+      j++;
 
-      // if we are small enough, we are done
-      if(_error <= delta) break;
+      if (done) break;
+      if (exceeded) {
+        cerr << "Budget exceeded: " << _budget->reason() << endl;
+        break;
+      }
 
       // else, we refine a subset (Dorfler marking); beware of squared errors
-      ElementSet marked;
-      scalar untilnow = 0;
-      for( auto const p : errvec) {
-        untilnow += p.first;
-        marked.insert(p.second);
-        if( untilnow >= _error * theta * theta * _error) break;
-      }
-      cerr << "needed " << marked.size() << " out of " << errvec.size() << " to get to theta=" << _theta << endl;
+      Marking::Indicators indicators = errors.indicators(_partition.leaves());
+      ElementSet marked = Marking::dorfler(indicators, _theta, _error * _error);
+      cerr << "needed " << marked.size() << " out of " << indicators.size() << " to get to theta=" << _theta << endl;
 
       _partition.refine(marked);
       ElementSet marked2;
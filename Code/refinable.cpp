@@ -109,7 +109,8 @@ ElementSet Refinable::bisect( Element *elt, bool checkForBoundary) {
   finder().rebuild(elt->left());
   finder().rebuild(elt->right());
 
-  // possibly update solution
+  // possibly update solution; both copies are lazy, so no polynomial work is
+  // done until the children's local vectors are actually asked for
   if( _sol.has(elt)) _sol.copyToChildren(elt);
 
   // update right hand side
@@ -117,6 +118,9 @@ ElementSet Refinable::bisect( Element *elt, bool checkForBoundary) {
 
   //we don't know if we are still conform
   _isConform = 0;               
+  _revision++;
+
+  if( _inTransaction) _journal.push_back(elt);
 
   // return the two elements we just created
   return ElementSet({elt->left(), elt->right()});
@@ -164,6 +168,61 @@ void Refinable::trim(Element *elt) {
 
   //we don't know if we're still conforming
   _isConform = 0;
+  _revision++;
+}
+
+/**
+ *  Undoes a single bisection of `elt`, whose children must be leaves.  The
+ *  children stay attached to `elt`, so that bisecting it again reuses them
+ *  instead of allocating new elements and vertices.  The DOFHandler is
+ *  restored from its own journal afterwards.
+ */
+void Refinable::unbisect(Element *elt) {
+  Element *children[] = {elt->left(), elt->right()};
+  for( auto &child : children) {
+    assert(child->isLeaf());
+    removeLeaf(child);
+    _rhs.erase(child);
+    if( _sol.has(child)) _sol.erase(child);
+    finder().remove(child);
+  }
+  finder().rebuild(elt);
+  addLeaf(elt);
+  _revision++;
+}
+
+void Refinable::beginTransaction() {
+  assert(!_inTransaction);
+  _inTransaction = true;
+  _isConformAtBegin = _isConform;
+  _journal.clear();
+  _handler.beginJournal();
+}
+
+void Refinable::commitTransaction() {
+  assert(_inTransaction);
+  _inTransaction = false;
+  _journal.clear();
+  _handler.commitJournal();
+}
+
+/**
+ *  Restores the leaves, the finder and the local vectors of the right-hand
+ *  side, the solution and the partition's DOFHandler to the state at
+ *  beginTransaction().  This costs time proportional to the number of
+ *  bisections and DOF changes since then, not to the size of the subtrees
+ *  below the old leaves, as trim() does.  Refinements done with another
+ *  DOFHandler, like the copy in the Refine estimator, change only that one.
+ */
+void Refinable::rollbackTransaction() {
+  assert(_inTransaction);
+  for( auto it = _journal.rbegin(); it != _journal.rend(); ++it) {
+    unbisect(*it);
+  }
+  _handler.rollbackJournal();
+  _isConform = _isConformAtBegin;
+  _inTransaction = false;
+  _journal.clear();
 }
 
 ElementSet Refinable::refineElement(Element *elt, DOFHandler &handler) {
@@ -459,6 +518,7 @@ void Refinable::determineBoundaryVertices() {
 
 void Refinable::resetRoots() {
   ElementTree::resetRoots();
+  _revision++;
   cerr << "RESET ROOTS"  << endl;
   for(auto &elt : _roots) {
     elt->_eltmats = new ElementMatrices(_bases, elt);
@@ -24,6 +24,20 @@ class Refinable : public Solvable {
   ElementSet refineLeavesUniformly(DOFHandler &handler);
   ElementSet refineLeavesUniformly() { return refineLeavesUniformly(_handler); }
 
+  /**
+   *  Journaled refinement: between beginTransaction() and the matching
+   *  commitTransaction() or rollbackTransaction(), every bisection is
+   *  recorded, and a rollback undoes exactly those in reverse order.
+   */
+  void beginTransaction();
+  void commitTransaction();
+  void rollbackTransaction();
+  bool inTransaction() const { return _inTransaction; }
+
+  // changes whenever the leaves change, and with them the restrictions of
+  // the right-hand side and the solution to the leaves
+  unsigned long revision() const { return _revision; }
+
   // determines if we are conforming.
   bool isConform(bool force = false);     
 
@@ -40,8 +54,17 @@ class Refinable : public Solvable {
   // -1: no, 0: not initialized, 1: yes
   int _isConform = -1;
 
+  unsigned long _revision = 0;
+
   Bases _bases;
 
+  // the elements bisected in the current transaction, in order
+  bool _inTransaction = false;
+  int _isConformAtBegin;
+  std::vector<Element *> _journal;
+
+  void unbisect(Element *elt);
+
   virtual ElementSet bisect(Element *elt, bool checkForBoundary = false);
 
   bool containsHangingVertex(Element *elt);
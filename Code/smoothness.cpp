@@ -0,0 +1,76 @@
+#include <cmath>
+#include <limits>
+#include <vector>
+
+#include "smoothness.h"
+#include "degree.h"
+
+using namespace std;
+
+scalar Smoothness::decayRate(Element *elt, const Vector &v) {
+  int p = Degree::dofToDegree(v.rows());
+  if( p < 2) return 0;
+
+  auto A = elt->elementMatrix(v.rows());
+  vector<scalar> energies(p + 1, 0);
+  int last = 0;
+  for( int d = 1; d <= p; d++) {
+    int first = d == 1 ? 0 : Degree::degreeToDim(d - 1);
+    int size = Degree::degreeToDim(d) - first;
+    auto ud = v.segment(first, size);
+    energies[d] = ud.dot(A.block(first, first, size, size) * ud);
+    if( energies[d] > 0) last = d;
+  }
+
+  // exactly representable with a lower degree
+  if( last < p) return numeric_limits<scalar>::infinity();
+
+  // least squares fit of log E_d = c - 2 sigma d; the vertex functions are
+  // the coarse scale rather than a term of the expansion, so they are left
+  // out when there are enough other degrees
+  scalar n = 0, sd = 0, sdd = 0, sl = 0, sdl = 0;
+  for( int d = p > 2 ? 2 : 1; d <= p; d++) {
+    if( energies[d] <= 0) continue;
+    scalar l = log(energies[d]);
+    n++; sd += d; sdd += d*d; sl += l; sdl += d*l;
+  }
+  if( n < 2) return 0;
+
+  scalar slope = (n*sdl - sd*sl) / (n*sdd - sd*sd);
+  return -slope / 2;
+}
+
+ElementScalarSet Smoothness::decayRates(const ElementSet &elts, const PiecewisePolynomial &u) {
+  // locallyAt() may materialize lazy restrictions, and elementMatrix() needs
+  // the triclass, so gather serially and fit in parallel
+  vector<Element *> todo(elts.begin(), elts.end());
+  vector<const Vector *> vectors;
+  vectors.reserve(todo.size());
+  for( Element *elt : todo) {
+    elt->triclass();
+    vectors.push_back(&u.locallyAt(elt));
+  }
+
+  vector<scalar> rates(todo.size());
+#pragma omp parallel for schedule(static)
+  for( size_t k = 0; k < todo.size(); k++) {
+    rates[k] = decayRate(todo[k], *vectors[k]);
+  }
+
+  ElementScalarSet ret;
+  for( size_t k = 0; k < todo.size(); k++) {
+    ret.insert(ret.end(), make_pair(todo[k], rates[k]));
+  }
+  return ret;
+}
+
+void Smoothness::split(const ElementSet &marked, const PiecewisePolynomial &u, scalar threshold,
+                       ElementSet &refine, ElementSet &enrich) {
+  for( auto &er : decayRates(marked, u)) {
+    if( er.second >= threshold) {
+      enrich.insert(er.first);
+    } else {
+      refine.insert(er.first);
+    }
+  }
+}
@@ -0,0 +1,37 @@
+#pragma once
+
+#include "config.h"
+#include "element.h"
+#include "piecewisepolynomial.h"
+#include "triangleset.h"
+
+/**
+ *  Estimates the local smoothness of a piecewise polynomial from how fast
+ *  its hierarchical coefficients decay.  The functions of degree d in the
+ *  basis are those with indices dim(d-1) up to dim(d), and their energy on
+ *  an element is E_d = u_d^T A_dd u_d, with A_dd the corresponding diagonal
+ *  block of the element matrix.  If u is analytic near the element, E_d
+ *  decays like exp(-2 sigma d); we fit sigma to log E_d by least squares.
+ *
+ *  A large sigma means more degrees will pay off (p-enrichment), a small one
+ *  that the element should rather be bisected (h-refinement).
+ */
+class Smoothness {
+public:
+  /**
+   *  The decay rates sigma on `elts`.  Elements of degree 1 have no decay
+   *  to measure and get rate 0; elements where the energy vanishes from
+   *  some degree on get infinity.
+   */
+  static ElementScalarSet decayRates(const ElementSet &elts, const PiecewisePolynomial &u);
+
+  /**
+   *  Splits `marked` into elements to bisect and to enrich, the latter being
+   *  those with decay rate at least `threshold`.
+   */
+  static void split(const ElementSet &marked, const PiecewisePolynomial &u, scalar threshold,
+                    ElementSet &refine, ElementSet &enrich);
+
+  // the decay rate of local vector `v` on `elt`
+  static scalar decayRate(Element *elt, const Vector &v);
+};
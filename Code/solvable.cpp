@@ -1,5 +1,9 @@
+#include <algorithm>
+#include <array>
+#include <memory>
 #include <queue>
 
+#include "asyncwriter.h"
 #include "fem/solution.h"
 #include "math.h"
 #include "print.h"
@@ -8,6 +12,149 @@
 
 using namespace std;
 
+/**
+ *  A flat copy of what one of the printers below writes: the vertices, and
+ *  per element its local dimension, vertices and tritype, with its local
+ *  vector or a single value.  Taking it is cheap compared to formatting it,
+ *  so the file variants take it here and leave the rest to the AsyncWriter.
+ */
+struct PrintSnapshot {
+  vector<scalar> xy;
+  vector<char> boundary;
+  vector<array<long long, 5>> elts;
+  vector<long long> index;
+  vector<size_t> rows = {0};
+  vector<scalar> values;
+
+  PrintSnapshot(const vector<Vertex *> &verts) {
+    for( auto v : verts) {
+      xy.push_back(v->x);
+      xy.push_back(v->y);
+      boundary.push_back(v->isBoundary());
+    }
+  }
+
+  void add(long long dim, Element *elt) {
+    elts.push_back({dim, elt->i(0), elt->i(1), elt->i(2), elt->type().toInt()});
+    index.push_back(elt->index());
+  }
+  void add(long long dim, Element *elt, const Vector &vec) {
+    add(dim, elt);
+    values.insert(values.end(), vec.data(), vec.data() + vec.rows());
+    rows.push_back(values.size());
+  }
+};
+
+namespace {
+// vertex i with its boundary flag, as in .sol files
+void printVert(const PrintSnapshot &s, size_t i, Formatter &f) {
+  f.fixed((double) s.xy[2*i], 16) << ' ';
+  f.fixed((double) s.xy[2*i + 1], 16) << ' ' << (int) s.boundary[i] << '\n';
+}
+
+// element k with its local vector, as PiecewisePolynomial::print
+void printElement(const PrintSnapshot &s, size_t k, Formatter &f) {
+  auto &e = s.elts[k];
+  f << e[0] << ' ' << e[1] << ' ' << e[2] << ' ' << e[3] << ' ' << e[4];
+  for( size_t i = s.rows[k]; i < s.rows[k+1]; i++) {
+    f << ' ';
+    f.fixed((double) s.values[i], 16);
+  }
+  f << '\n';
+}
+
+// the vertices with their boundary flags, as in .sol files
+void printVerts(const PrintSnapshot &s, Formatter &f) {
+  f << s.boundary.size() << '\n';
+  for( size_t i = 0; i < s.boundary.size(); i++) printVert(s, i, f);
+}
+
+void printSolution(const PrintSnapshot &s, ostream &os) {
+  Formatter f(os);
+  f << "tridim tritype sol\n";
+  printVerts(s, f);
+
+  f << s.elts.size() << '\n';
+  for( size_t k = 0; k < s.elts.size(); k++) printElement(s, k, f);
+}
+
+bool sameElement(const PrintSnapshot &s, size_t k, const PrintSnapshot &t, size_t l) {
+  return s.elts[k] == t.elts[l] && s.rows[k+1] - s.rows[k] == t.rows[l+1] - t.rows[l]
+      && equal(s.values.begin() + s.rows[k], s.values.begin() + s.rows[k+1], t.values.begin() + t.rows[l]);
+}
+
+/**
+ *  The changes from solution `prev` to solution `s`, see OutputPolicy.h: the
+ *  number of vertices and the new or changed ones, prefixed by their index;
+ *  the number of elements, the indices of those removed, and the new or
+ *  changed ones, prefixed by their index.  Both are ordered by index.
+ */
+void printSolutionDelta(const PrintSnapshot &prev, const PrintSnapshot &s, ostream &os) {
+  vector<size_t> verts;
+  for( size_t i = 0; i < s.boundary.size(); i++) {
+    if( i >= prev.boundary.size() || s.boundary[i] != prev.boundary[i]
+        || s.xy[2*i] != prev.xy[2*i] || s.xy[2*i + 1] != prev.xy[2*i + 1]) {
+      verts.push_back(i);
+    }
+  }
+
+  vector<long long> removed;
+  vector<size_t> changed;
+  size_t l = 0;
+  for( size_t k = 0; k < s.elts.size(); k++) {
+    for( ; l < prev.elts.size() && prev.index[l] < s.index[k]; l++) removed.push_back(prev.index[l]);
+    if( l < prev.elts.size() && prev.index[l] == s.index[k]) {
+      if( !sameElement(s, k, prev, l)) changed.push_back(k);
+      l++;
+    } else {
+      changed.push_back(k);
+    }
+  }
+  for( ; l < prev.elts.size(); l++) removed.push_back(prev.index[l]);
+
+  Formatter f(os);
+  f << "tridim tritype sol delta\n";
+  f << s.boundary.size() << ' ' << verts.size() << '\n';
+  for( size_t i : verts) {
+    f << i << ' ';
+    printVert(s, i, f);
+  }
+  f << s.elts.size() << ' ' << removed.size() << ' ' << changed.size() << '\n';
+  for( long long index : removed) f << index << '\n';
+  for( size_t k : changed) {
+    f << s.index[k] << ' ';
+    printElement(s, k, f);
+  }
+}
+
+void printHpMesh(const PrintSnapshot &s, ostream &os) {
+  Formatter f(os);
+  f << "tritype tridim\n";
+  f << s.boundary.size() << '\n';
+  for( size_t i = 0; i < s.boundary.size(); i++) {
+    f.fixed((double) s.xy[2*i], 16) << ' ';
+    f.fixed((double) s.xy[2*i + 1], 16) << '\n';
+  }
+  f << s.elts.size() << '\n';
+  for( auto &e : s.elts) {
+    f << e[0] << ' ' << e[1] << ' ' << e[2] << ' ' << e[3] << ' ' << e[4] << '\n';
+  }
+}
+
+void printElementScalarSet(const PrintSnapshot &s, ostream &os) {
+  Formatter f(os);
+  f << "tridim error\n";
+  printVerts(s, f);
+
+  f << s.elts.size() << '\n';
+  for( size_t k = 0; k < s.elts.size(); k++) {
+    auto &e = s.elts[k];
+    f << e[0] << ' ' << e[1] << ' ' << e[2] << ' ' << e[3] << ' ';
+    f.general((double) s.values[k]) << '\n';
+  }
+}
+}
+
 /**
  * This routine solves the sparse linear system Ax=b, where A is the stiffness 
  * matrix, and b the load vector.
@@ -23,36 +170,50 @@ std::unique_ptr<FEM::Solver> Solvable::solve() {
   return solver;
 }
 
+std::unique_ptr<FEM::Solver> Solvable::solve(scalar tolerance) {
+  assert(handler().valid());
+  auto solver = std::make_unique<FEM::Solver>(handler(), _rhs, tolerance, _sol);
+  _sol = solver->sol();
+  return solver;
+}
+
 ostream &Solvable::printLinearInterpolant( ostream &os) {
-  os << Print::formatted("tridim linsol") << endl;
-  os << Print::formatted("%lu", _verts.size()) << endl;
-  for(auto v : _verts) os << Print::formatted("%.16f %.16f", (double) v->x, (double) v->y) << endl;
+  Formatter f(os);
+  f << "tridim linsol\n";
+  f << _verts.size() << '\n';
+  for(auto v : _verts) {
+    f.fixed((double) v->x, 16) << ' ';
+    f.fixed((double) v->y, 16) << '\n';
+  }
 
-  os << Print::formatted("%lu", _sol.definedOn().size()) << endl;
+  f << _sol.definedOn().size() << '\n';
   for(Element *elt : _sol.definedOn()) {
-    os << Print::formatted("%lu %d %d %d",
-        _sol.local_dim(elt), elt->i(0), elt->i(1), elt->i(2)) << endl;
+    f << _sol.local_dim(elt) << ' ' << elt->i(0) << ' ' << elt->i(1) << ' ' << elt->i(2) << '\n';
   }
 
-  os << Print::formatted("%lu", leaves().size()) << endl;
+  f << leaves().size() << '\n';
   for(Element *elt : leaves()) {
     Vector local = _sol.locallyAt(elt).head(3);
-    os << Print::formatted("%lu %d %d %d",
-        _sol.local_dim(elt), elt->i(0), elt->i(1), elt->i(2));
+    f << _sol.local_dim(elt) << ' ' << elt->i(0) << ' ' << elt->i(1) << ' ' << elt->i(2);
     for( int i = 0; i < 3; i++) {
-      os << Print::formatted(" %.16f", (double) local[i]);
+      f << ' ';
+      f.fixed((double) local[i], 16);
     }
-    os << endl;
+    f << '\n';
   }
 
   return os;
 }
 
 ostream &Solvable::printDOFs( ostream &os) {
-  os << "tridim tritype dof" << endl;
-  os << _verts.size() << endl;
-  for(auto v : _verts) {
-    os << v->x << " " << v->y << " " << handler().find(v) << endl;
+  {
+    Formatter f(os);
+    f << "tridim tritype dof\n";
+    f << _verts.size() << '\n';
+    for(auto v : _verts) {
+      f.general(v->x) << ' ';
+      f.general(v->y) << ' ' << handler().find(v) << '\n';
+    }
   }
   handler().print(os);
   return os;
@@ -62,23 +223,28 @@ ostream &Solvable::printDOFs( ostream &os) {
  * TODO!
  */
 ostream &Solvable::printSolution( ostream &os) {
-  os << Print::formatted("tridim tritype sol") << endl;
-  os << Print::formatted("%lu", _verts.size()) << endl;
-  for(auto v : _verts) {
-    os << Print::formatted("%.16f %.16f %d",
-        (double) v->x, (double) v->y, v->isBoundary()) << endl;
-  }
-
-  _sol.print(os);
+  ::printSolution(solutionSnapshot(), os);
   return os;
 }
 
+PrintSnapshot Solvable::solutionSnapshot() {
+  PrintSnapshot s(_verts);
+  for( Element *elt : _sol.definedOn()) {
+    const Vector &vec = _sol.locallyAt(elt);
+    s.add(vec.rows(), elt, vec);
+  }
+  return s;
+}
+
 ostream &Solvable::printRhsMesh( ostream &os) {
-  os << Print::formatted("tridim tritype sol") << endl;
-  os << Print::formatted("%lu", _verts.size()) << endl;
-  for(auto v : _verts) {
-    os << Print::formatted("%.16f %.16f %d",
-        (double) v->x, (double) v->y, v->isBoundary()) << endl;
+  {
+    Formatter f(os);
+    f << "tridim tritype sol\n";
+    f << _verts.size() << '\n';
+    for(auto v : _verts) {
+      f.fixed((double) v->x, 16) << ' ';
+      f.fixed((double) v->y, 16) << ' ' << v->isBoundary() << '\n';
+    }
   }
 
   _rhs.print(leaves(), os);
@@ -86,28 +252,25 @@ ostream &Solvable::printRhsMesh( ostream &os) {
 }
 
 ostream &Solvable::printElementScalarSet(const ElementScalarSet &on, ostream &os) {
-  os << Print::formatted("tridim error") << endl;
-  os << Print::formatted("%lu", _verts.size()) << endl;
-  for(auto v : _verts) {
-    os << Print::formatted("%.16f %.16f %d",
-        (double) v->x, (double) v->y, v->isBoundary()) << endl;
-  }
-
+  ::printElementScalarSet(elementScalarSetSnapshot(on), os);
+  return os;
+}
 
-  os << Print::formatted("%lu", on.size()) << endl;
+PrintSnapshot Solvable::elementScalarSetSnapshot(const ElementScalarSet &on) {
+  PrintSnapshot s(_verts);
   for( auto &eltdbl : on) {
-    Element *elt = eltdbl.first;
-    os << Print::formatted("%d %d %d %d %g\n",
-        _sol.local_dim(elt), elt->i(0), elt->i(1), elt->i(2),
-        (double) eltdbl.second);
+    s.add(_sol.local_dim(eltdbl.first), eltdbl.first);
+    s.values.push_back(eltdbl.second);
   }
-  return os;
+  return s;
 }
 
 ostream &Solvable::printVerts( ostream &os) {
-  os << _verts.size() << endl;
+  Formatter f(os);
+  f << _verts.size() << '\n';
   for(auto v : _verts) {
-    os << Print::formatted("%.16f %.16f", (double) v->x, (double) v->y) << endl;
+    f.fixed((double) v->x, 16) << ' ';
+    f.fixed((double) v->y, 16) << '\n';
   }
   return os;
 }
@@ -115,35 +278,32 @@ ostream &Solvable::printVerts( ostream &os) {
 ostream &Solvable::printLeaves( ostream &os) {
   os << "tritype" << endl;
   printVerts(os);
-  os << Print::formatted("%lu", _leaves.size()) << endl;
+  Formatter f(os);
+  f << _leaves.size() << '\n';
   for(auto &elt : _leaves) {
-    os << elt->i(0) << " " << elt->i(1) << " " << elt->i(2) << " "
-       << elt->type().toInt() << endl;
+    f << elt->i(0) << ' ' << elt->i(1) << ' ' << elt->i(2) << ' ' << elt->type().toInt() << '\n';
   }
   return os;
 }
 
 ostream &Solvable::printHpMesh( ostream &os) {
-  os << "tritype tridim" << endl;
-  printVerts(os);
-  os << Print::formatted("%lu", _leaves.size()) << endl;
-  for(auto &elt : _leaves) {
-    os << handler().find(elt).dim() 
-       << " " << elt->i(0) 
-       << " " << elt->i(1) 
-       << " " << elt->i(2) 
-       << " " << elt->type().toInt() 
-       << endl;
-  }
-
+  ::printHpMesh(hpMeshSnapshot(), os);
   return os;
 }
 
+PrintSnapshot Solvable::hpMeshSnapshot() {
+  PrintSnapshot s(_verts);
+  for(auto &elt : _leaves) s.add(handler().find(elt).dim(), elt);
+  return s;
+}
+
+/**
+ *  The file variants of the printers that run every iteration only take a
+ *  snapshot, and leave formatting and writing to the AsyncWriter.
+ */
 void Solvable::printHpMesh(string filename) {
-  ofstream os(filename, ofstream::trunc);
-  printHpMesh(os);
-  os.flush();
-  os.close();
+  auto s = make_shared<PrintSnapshot>(hpMeshSnapshot());
+  AsyncWriter::instance().write(filename, [s](ostream &os) { ::printHpMesh(*s, os); });
 }
 
 void Solvable::printLinearInterpolant(string filename) {
@@ -175,16 +335,19 @@ void Solvable::printDOFs(string filename) {
 }
 
 void Solvable::printSolution(string filename) {
-  ofstream os(filename, ofstream::trunc);
-  printSolution(os);
-  os.flush();
-  os.close();
+  auto s = make_shared<PrintSnapshot>(solutionSnapshot());
+  AsyncWriter::instance().write(filename, [s](ostream &os) { ::printSolution(*s, os); });
+}
+
+void Solvable::printSolutionDelta(string filename, shared_ptr<const PrintSnapshot> &previous) {
+  auto prev = previous ? previous : make_shared<PrintSnapshot>(vector<Vertex *>());
+  auto s = make_shared<PrintSnapshot>(solutionSnapshot());
+  previous = s;
+  AsyncWriter::instance().write(filename, [prev, s](ostream &os) { ::printSolutionDelta(*prev, *s, os); });
 }
 
 void Solvable::printElementScalarSet(
     const ElementScalarSet &on, string filename) {
-  ofstream os(filename, ofstream::trunc);
-  printElementScalarSet(on, os);
-  os.flush();
-  os.close();
+  auto s = make_shared<PrintSnapshot>(elementScalarSetSnapshot(on));
+  AsyncWriter::instance().write(filename, [s](ostream &os) { ::printElementScalarSet(*s, os); });
 }
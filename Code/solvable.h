@@ -23,6 +23,7 @@
 
 #pragma once
 #include <map>
+#include <memory>
 #include <fstream>
 #include <iostream>
 #include "elementtree.h"
@@ -33,6 +34,8 @@
 #include "fem/solver.h"
 #include "fem/rhs.h"
 
+struct PrintSnapshot;
+
 class Solvable : public ElementTree {
  public:
   Solvable() : ElementTree(), _handler(finder()) {}
@@ -41,6 +44,9 @@ class Solvable : public ElementTree {
   void resetSolution() { setSolution(FEM::Solution()); }
   std::unique_ptr<FEM::Solver> solve();
 
+  // solves iteratively up to `tolerance`, starting from the current solution
+  std::unique_ptr<FEM::Solver> solve(scalar tolerance);
+
   /* expose some members */
   FEM::Solution &sol() { return _sol; }
   FEM::Rhs &rhs() { return _rhs; }
@@ -54,6 +60,9 @@ class Solvable : public ElementTree {
   void          printDOFs(std::string filename);
   std::ostream &printSolution(std::ostream &os = std::cout);
   void          printSolution(std::string filename);
+  // writes the changes since `previous`, which then becomes the current
+  // solution; see OutputPolicy.h
+  void          printSolutionDelta(std::string filename, std::shared_ptr<const PrintSnapshot> &previous);
   std::ostream &printLeaves(std::ostream &os = std::cout);
   void          printLeaves(std::string filename);
   std::ostream &printRhsMesh(std::ostream &os = std::cout);
@@ -64,6 +73,11 @@ class Solvable : public ElementTree {
   void          printElementScalarSet(const ElementScalarSet &on, std::string filename);
 
  protected:
+  // flat copies of what the printers write, see solvable.cpp
+  PrintSnapshot solutionSnapshot();
+  PrintSnapshot hpMeshSnapshot();
+  PrintSnapshot elementScalarSetSnapshot(const ElementScalarSet &on);
+
   FEM::Solution _sol;
   FEM::Rhs _rhs;
   DOFHandler _handler;
@@ -7,6 +7,12 @@
 #include "../partition.h"
 #include "../nearbest.h"
 #include "../errorestimator/refine.h"
+#include "../errorestimator/residual.h"
+#include "../errorestimator/patch.h"
+#include "../errorestimator/surplus.h"
+#include "../budget.h"
+#include "../checkpoint.h"
+#include "../outputpolicy.h"
 #include "../reduce.h"
 
 using namespace std;
@@ -28,6 +34,12 @@ class Options {
   bool print_rhs = false;
   string paramstring = "";
   bool analyze = false;
+  string estimator = "refine";
+  scalar solve_fraction = 0;
+  Budget budget;
+  string checkpoint = "";
+  string resume = "";
+  OutputPolicy output{"output/testLshaped.manifest"};
 
   string rhs() {
     auto slash = rhsfile.find_last_of("/")+1;
@@ -81,6 +93,38 @@ class Options {
       case 'p':
         arguments->print_rhs = atoi(arg) > 0;
         break;
+      case 's':
+        arguments->solve_fraction = atof(arg);
+        arguments->paramstring = arguments->paramstring + "_s" + arg;
+        break;
+      case 'N':
+        arguments->budget.maxDOFs = atoi(arg);
+        break;
+      case 'M':
+        arguments->budget.maxMemory = atof(arg);
+        break;
+      case 'T':
+        arguments->budget.maxSeconds = atof(arg);
+        break;
+      case 'c':
+        arguments->checkpoint = arg;
+        break;
+      case 'R':
+        arguments->resume = arg;
+        break;
+      case 'o':
+        if (!arguments->output.parseCadence(arg)) argp_error(state, "invalid output cadence %s", arg);
+        break;
+      case 'd':
+        arguments->output.delta = atoi(arg);
+        break;
+      case 'V':
+        arguments->output.vtu = atoi(arg);
+        break;
+      case 'e':
+        arguments->estimator = arg;
+        arguments->paramstring = arguments->paramstring + "_e" + arg;
+        break;
       default:
         return ARGP_ERR_UNKNOWN;
     }
@@ -101,11 +145,28 @@ static struct argp_option options[] = {
   {"hafem",     'h', "natural",     0, "hp-AFEM iteration above which to do h-AFEM"},
   {"printrhs",  'p', "bool",        0, "print FEM RHS to file after each iteration"},
   {"analyze",   'a', "bool",        0, "Analyze global stiffness matrix"},
+  {"estimator", 'e', "NAME",        0, "Error estimator in Reduce: refine, residual, patch or surplus"},
+  {"solve",     's', "[0,1)",       0, "Solve iteratively in Reduce, up to this fraction of the estimated error; 0 solves directly"},
+  {"maxdofs",   'N', "natural",     0, "Stop when the number of DOFs exceeds this"},
+  {"maxmemory", 'M', "MiB",         0, "Stop when the resident memory exceeds this"},
+  {"maxtime",   'T', "seconds",     0, "Stop when the wall-clock time exceeds this"},
+  {"checkpoint",'c', "FILE",        0, "Write a checkpoint to FILE at the start of every iteration"},
+  {"resume",    'R', "FILE",        0, "Resume from the checkpoint in FILE instead of starting over"},
+  {"output",    'o', "K|outer",     0, "Write the solution every K iterations of Reduce, or only at the end of each"},
+  {"delta",     'd', "bool",        0, "Write only what changed since the last solution written; see tools/undelta"},
+  {"vtu",       'V', "bool",        0, "Also write every solution written as a .vtu file, for ParaView"},
   { 0 }
 };
 
 static struct argp argp = { options, HpAFEM::Options::parse_opt, "hay", "heyu" };
 
+template <class E>
+scalar reduce(Partition &p, scalar delta, scalar theta, scalar solve_fraction, Budget &budget,
+              OutputPolicy &output, ostream &os) {
+  Reduce<E> reduce(p, p.sol(), delta, theta, false, os, solve_fraction, &budget, &output);
+  return reduce.error();
+}
+
 int main(int argc, char **argv) {
   HpAFEM::Options options;
   argp_parse(&argp, argc, argv, 0, 0, &options);
@@ -122,49 +183,81 @@ int main(int argc, char **argv) {
   outstream << "rhs file: " << options.rhsfile << endl;
   outstream << endl;
 
-  Partition p(options.bases, options.meshfile, options.rhsfile);
-
-  p.handler().increaseTo(p.leaves(), Degree::degreeToDim(options.initial_degree));
-
-  p.refineLeavesUniformly();
-  p.refineLeavesUniformly();
-
-  outstream << "Initial triangulation settings:" << endl;
-  outstream << "initial degree: " << options.initial_degree << endl;
-  outstream << "number of triangles: " << p.leaves().size() << endl;
-  outstream << endl;
-
-  //p.handler().redetermineOn(p.leaves());
-  p.solve();
+  Checkpoint checkpoint;
+  unique_ptr<Partition> partition;
+  if (options.resume.size()) {
+    partition = checkpoint.load(options.bases, options.resume);
+  } else {
+    partition.reset(new Partition(options.bases, options.meshfile, options.rhsfile));
+  }
+  Partition &p = *partition;
 
-  RefineEstimator initialError(p, p.sol());
-  outstream << "Error estimator settings:" << endl;
-  outstream << "h-refines: " << refine_error_est_h << endl;
-  outstream << "p-refines: " << refine_error_est_p << endl;
+  scalar epsilon, fineps;
+  int i = 0;
+  if (options.resume.size()) {
+    epsilon = checkpoint.epsilon;
+    fineps = checkpoint.fineps;
+    i = checkpoint.iteration;
+    Reduce<RefineEstimator>::setCount(i);
+    Reduce<ErrorEstimator::Residual>::setCount(i);
+    Reduce<ErrorEstimator::Patch>::setCount(i);
+    Reduce<ErrorEstimator::Surplus>::setCount(i);
+    outstream << "Resumed from " << options.resume << " at iteration " << i << endl;
+    outstream << "--------------" << endl;
+    outstream.flush();
+  } else {
+    p.handler().increaseTo(p.leaves(), Degree::degreeToDim(options.initial_degree));
+
+    p.refineLeavesUniformly();
+    p.refineLeavesUniformly();
+
+    outstream << "Initial triangulation settings:" << endl;
+    outstream << "initial degree: " << options.initial_degree << endl;
+    outstream << "number of triangles: " << p.leaves().size() << endl;
+    outstream << endl;
+
+    //p.handler().redetermineOn(p.leaves());
+    p.solve();
 
-  scalar epsilon = initialError.error();
-  scalar fineps = epsilon/5000000000;
-  outstream << "initial error: " << epsilon << endl;
-  outstream << endl;
+    RefineEstimator initialError(p, p.sol());
+    outstream << "Error estimator settings:" << endl;
+    outstream << "h-refines: " << refine_error_est_h << endl;
+    outstream << "p-refines: " << refine_error_est_p << endl;
+
+    epsilon = initialError.error();
+    fineps = epsilon/5000000000;
+    outstream << "initial error: " << epsilon << endl;
+    outstream << endl;
+
+    outstream << "hp-AFEM settings:" << endl;
+    outstream << "theta: " << options.theta << endl;
+    outstream << "omega: " << options.omega << endl;
+    outstream << "mu: " << options.mu << endl;
+    outstream << "--------------" << endl;
+    outstream.flush();
+  }
 
-  outstream << "hp-AFEM settings:" << endl;
-  outstream << "theta: " << options.theta << endl;
-  outstream << "omega: " << options.omega << endl;
-  outstream << "mu: " << options.mu << endl;
-  outstream << "--------------" << endl;
-  outstream.flush();
+  // kept alive over all iterations, so that NearBest reuses its combination
+  // tree over the roots
+  NearBest nearbest(p, p.sol());
 
-  int i = 0;
-  while( epsilon > fineps) {
+  while( epsilon > fineps && !options.budget.exceeded()) {
     cerr << endl;
 
+    if (options.checkpoint.size()) {
+      checkpoint.epsilon = epsilon;
+      checkpoint.fineps = fineps;
+      checkpoint.iteration = i;
+      checkpoint.save(p, options.checkpoint);
+    }
+
     RefineEstimator prestartError(p, p.sol());
 
     scalar prestart_h1_error = prestartError.error();
     outstream << "1 " << prestart_h1_error << endl;
     cerr << "Going into NearBest" << endl;
     //find a good approximation to the current numerical solution
-    NearBest(p, p.sol(), options.omega*epsilon, 1000000, outstream);
+    nearbest.run(options.omega*epsilon, options.budget.cap(1000000), outstream);
     cerr << "nu hier" <<endl;
     p.printHpMesh("output/endmesh_" + to_string(++i) + ".mesh");
 
@@ -193,23 +286,38 @@ int main(int argc, char **argv) {
     
     //refine some more
     cerr << "Going to refine to get the necessary error" << endl;
-    if(options.hafem_do && i >= options.hafem_iter) {
-      Reduce<RefineEstimator> reduce(p, p.sol(), 0, options.theta, false, outstream);
-      cerr << "final error was " << reduce.error() << endl;
+    scalar delta = (options.hafem_do && i >= options.hafem_iter) ? 0 : options.mu*epsilon;
+    scalar reduced;
+    if (options.estimator == "residual") {
+      reduced = reduce<ErrorEstimator::Residual>(p, delta, options.theta, options.solve_fraction, options.budget, options.output, outstream);
+    } else if (options.estimator == "patch") {
+      reduced = reduce<ErrorEstimator::Patch>(p, delta, options.theta, options.solve_fraction, options.budget, options.output, outstream);
+    } else if (options.estimator == "surplus") {
+      reduced = reduce<ErrorEstimator::Surplus>(p, delta, options.theta, options.solve_fraction, options.budget, options.output, outstream);
     } else {
-      Reduce<RefineEstimator> reduce(p, p.sol(), options.mu*epsilon,
-                                     options.theta, false, outstream);
-      cerr << "final error was " << reduce.error() << endl;
+      reduced = reduce<RefineEstimator>(p, delta, options.theta, options.solve_fraction, options.budget, options.output, outstream);
     }
+    cerr << "final error was " << reduced << endl;
+    if (options.budget.hit()) break;
 
     //find approximation to solution
     epsilon *= options.mu;
   }
   
-  int Nmax = 1000000;
+  // out of budget: keep the last solution of Reduce as the final one
+  if (options.budget.hit()) {
+    cerr << "Budget exceeded: " << options.budget.reason() << endl;
+    outstream << "6 " << options.budget.reason() << endl;
+    string solfile = "output/testLshaped_final_budget.sol";
+    cerr << "Saving to " << solfile << endl;
+    p.printSolution(solfile);
+    return 0;
+  }
+
+  int Nmax = options.budget.cap(1000000);
   cerr << endl;
   cerr << "Calling NearBest one last time" << endl;
-  NearBest(p, p.sol(), options.omega*epsilon, Nmax, outstream);
+  nearbest.run(options.omega*epsilon, Nmax, outstream);
   cerr << "nu hier" <<endl;
 
   cerr << "Conforming and recomputing DOFs" << endl;
@@ -2,9 +2,13 @@
 #include <string>
 #include <argp.h>
 
+#include "../budget.h"
 #include "../print.h"
 #include "../partition.h"
 #include "../errorestimator/refine.h"
+#include "../marking.h"
+#include "../outputpolicy.h"
+#include "../smoothness.h"
 
 using namespace std;
 
@@ -14,6 +18,11 @@ class Options {
  public:
   int initial_degree = 2;
   scalar theta = 0.8;
+  // decay rate above which marked elements are enriched; if negative, the
+  // elements touching a corner of the L-shape are refined instead
+  scalar smoothness = -1;
+  Budget budget;
+  OutputPolicy output{"output/testideal.manifest"};
   string bases =        "../../CombinedBases/degree20/";
   string meshfile =     "../../Meshes/lshaped6.mesh";
   string rhsfile =      "../../Meshes/lshaped6_ones.rhs";
@@ -40,6 +49,28 @@ class Options {
         arguments->theta = atof(arg);
         arguments->paramstring = arguments->paramstring + "_t" + arg;
         break;
+      case 's':
+        arguments->smoothness = atof(arg);
+        arguments->paramstring = arguments->paramstring + "_s" + arg;
+        break;
+      case 'N':
+        arguments->budget.maxDOFs = atoi(arg);
+        break;
+      case 'M':
+        arguments->budget.maxMemory = atof(arg);
+        break;
+      case 'T':
+        arguments->budget.maxSeconds = atof(arg);
+        break;
+      case 'o':
+        if (!arguments->output.parseCadence(arg)) argp_error(state, "invalid output cadence %s", arg);
+        break;
+      case 'd':
+        arguments->output.delta = atoi(arg);
+        break;
+      case 'V':
+        arguments->output.vtu = atoi(arg);
+        break;
       case 'i':
         arguments->initial_degree = atoi(arg);
         break;
@@ -63,6 +94,13 @@ class Options {
 
 static struct argp_option options[] = {
   {"theta",     't', "(0..1]",      0, "Value of theta"},
+  {"smoothness", 's', "SIGMA",      0, "Enrich marked elements whose coefficients decay at least this fast, refine the others"},
+  {"maxdofs",   'N', "natural",     0, "Stop when the number of DOFs exceeds this"},
+  {"maxmemory", 'M', "MiB",         0, "Stop when the resident memory exceeds this"},
+  {"maxtime",   'T', "seconds",     0, "Stop when the wall-clock time exceeds this"},
+  {"output",    'o', "K|outer",     0, "Write the solution every K iterations; with outer, only the last"},
+  {"delta",     'd', "bool",        0, "Write only what changed since the last solution written; see tools/undelta"},
+  {"vtu",       'V', "bool",        0, "Also write every solution written as a .vtu file, for ParaView"},
   {"initdeg",   'i', "natural",     0, "Initial degree"},
   {"basesdir",  'b', "DIR",         0, "Bases directory"},
   {"meshfile",  'm', "FILE",        0, "File with initial h-triangulation"},
@@ -139,44 +177,47 @@ int main(int argc, char **argv) {
     int numdofs = p.handler().recomputeNumDOFs();
     cerr << numdofs << " " << epsilon << endl;
 
-    string solfile = Print::formatted("output/testideal_%d_%d.sol", i++, numdofs);
-    cerr << "\t sol: " << solfile << endl;
-    p.printSolution(solfile);
+    // the solution is the final one if it is small enough, or if we are out
+    // of budget
+    bool done = epsilon < fineps;
+    bool exceeded = !done && options.budget.exceeded(numdofs);
 
-    // compute the local error on each element and store in a vector
-    std::vector<std::pair<scalar, Element *>> errvec;
-    for( auto const p : errors.on(p.leaves())) {
-      errvec.push_back(make_pair(p.second, p.first));
+    if (options.output.due(i, done || exceeded)) {
+      string solfile = Print::formatted("output/testideal_%d_%d.sol", i, numdofs);
+      cerr << "\t sol: " << solfile << endl;
+      options.output.printSolution(p, solfile, &errors);
     }
+    i++;
 
-    // sort this vector by error in descending order
-    std::sort(errvec.begin(), errvec.end());
-    std::reverse(errvec.begin(), errvec.end());
-
-    if (epsilon < fineps) break;
+    if (done) break;
+    if (exceeded) {
+      cerr << "Budget exceeded: " << options.budget.reason() << endl;
+      outstream << "6 " << options.budget.reason() << endl;
+      break;
+    }
 
     // else, we refine a subset (Dorfler marking); beware of squared errors
-    ElementSet marked;
-    scalar untilnow = 0;
-    for( auto const p : errvec) {
-      untilnow += p.first;
-      marked.insert(p.second);
-      if (untilnow >= epsilon * options.theta * options.theta * epsilon) break;
-    }
+    ElementSet marked = Marking::dorfler(errors.indicators(p.leaves()), options.theta, epsilon * epsilon);
 
     ElementSet to_refine;
     ElementSet to_enrich;
-    for (auto elt : marked) {
-      // if touches a corner: h-refine
-      if (touches_corner(elt)) {
-        to_refine.insert(elt);
-      // else: p-enrich
-      } else {
-        to_enrich.insert(elt);
+    if (options.smoothness >= 0) {
+      Smoothness::split(marked, p.sol(), options.smoothness, to_refine, to_enrich);
+    } else {
+      for (auto elt : marked) {
+        // if touches a corner: h-refine
+        if (touches_corner(elt)) {
+          to_refine.insert(elt);
+        // else: p-enrich
+        } else {
+          to_enrich.insert(elt);
+        }
       }
     }
-    p.refine(to_refine);
+    // enrich first: refining may bisect elements of to_enrich as well to keep
+    // the mesh conforming, and their children then inherit the new degree
     p.handler().increaseDegreeBy(to_enrich, 1);
+    p.refine(to_refine);
   }
   return 0;
 }
@@ -6,6 +6,7 @@
  */
 
 #include <iostream>
+#include <sstream>
 #include <Eigen/Sparse>
 #include <argp.h>
 
@@ -14,6 +15,9 @@
 #include "../fem/solver.h"
 #include "../partition.h"
 #include "../errorestimator/refine.h"
+#include "../errorestimator/residual.h"
+#include "../errorestimator/patch.h"
+#include "../errorestimator/surplus.h"
 
 using namespace std;
 
@@ -27,6 +31,7 @@ class Options {
   string meshfile =     "../../Meshes/lshaped6.mesh";
   string rhsfile =      "../../Meshes/lshaped6_ones.rhs";
   bool analyze = false;
+  string estimator = "refine";
 
   string to_string() {
     return meshfile + " " + rhsfile + " " + infile + " " + std::to_string(hrefines) + " " + std::to_string(prefines);
@@ -68,6 +73,9 @@ class Options {
       case 'a':
         arguments->analyze = atoi(arg) > 0;
         break;
+      case 'e':
+        arguments->estimator = arg;
+        break;
       default:
         return ARGP_ERR_UNKNOWN;
     }
@@ -85,6 +93,7 @@ static struct argp_option options[] = {
   {"meshfile",  'm', "FILE",        0, "File with initial h-triangulation"},
   {"rhsfile",   'r', "FILE",        0, "File with forcing function on `meshfile`"},
   {"analyze",   'a', "bool",        0, "Analyze global stiffness matrix"},
+  {"estimator", 'e', "NAME",        0, "Also compute this estimator next to refine: residual, patch or surplus"},
   { 0 }
 };
 
@@ -223,8 +232,20 @@ int main(int argc, char **argv) {
 
       ErrorEstimator::Refine estimated_error(rp, rp.sol(), options.hrefines, options.prefines);
       ofstream outstream(outfile, ofstream::app);
-      cerr << options.to_string() << " " << estimated_error.error() << endl;
-      outstream << options.to_string() << " " << estimated_error.error() << endl;
+      ostringstream line;
+      line << options.to_string() << " " << estimated_error.error();
+      if (options.estimator == "residual") {
+        ErrorEstimator::Residual other(rp, rp.sol());
+        line << " residual " << other.error();
+      } else if (options.estimator == "patch") {
+        ErrorEstimator::Patch other(rp, rp.sol());
+        line << " patch " << other.error();
+      } else if (options.estimator == "surplus") {
+        ErrorEstimator::Surplus other(rp, rp.sol());
+        line << " surplus " << other.error();
+      }
+      cerr << line.str() << endl;
+      outstream << line.str() << endl;
       outstream.close();
     }
   }
@@ -0,0 +1,32 @@
+#include <iostream>
+#include <string>
+
+#include "../meshfile.h"
+
+using namespace std;
+
+/**
+ *  Converts a .mesh, .rhs or .sol file between its text and binary forms:
+ *
+ *    convert IN OUT
+ *
+ *  If IN is binary, OUT is written as text, and vice versa.  The kind of a
+ *  text file is told by its extension, so a binary file that is converted
+ *  back should get the extension of its kind.
+ */
+int main(int argc, char **argv) {
+  if (argc != 3) {
+    cerr << "usage: " << argv[0] << " IN OUT" << endl;
+    return 1;
+  }
+  string in = argv[1], out = argv[2];
+
+  if (MeshFile::isBinary(in)) {
+    MeshFile::writeText(MeshFile(in).data(), out);
+    cerr << "Wrote " << out << " as text" << endl;
+  } else {
+    MeshFile::write(MeshFile::readText(in), out);
+    cerr << "Wrote " << out << " as binary" << endl;
+  }
+  return 0;
+}
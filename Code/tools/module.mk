@@ -1 +1 @@
-BINS += tools/generateRhs
+BINS += tools/generateRhs tools/convert tools/undelta tools/sol2vtu
@@ -0,0 +1,49 @@
+#include <algorithm>
+#include <cstdlib>
+#include <iostream>
+#include <string>
+
+#include "../degree.h"
+#include "../meshfile.h"
+#include "../vtufile.h"
+
+using namespace std;
+
+/**
+ *  Converts a .sol file, text or binary, to a .vtu file for ParaView:
+ *
+ *    sol2vtu IN OUT [SUBDIVISION]
+ *
+ *  Every element of degree p is drawn with (p*SUBDIVISION)^2 triangles.
+ */
+int main(int argc, char **argv) {
+  if (argc != 3 && argc != 4) {
+    cerr << "usage: " << argv[0] << " IN OUT [SUBDIVISION]" << endl;
+    return 1;
+  }
+  string in = argv[1], out = argv[2];
+  int subdivision = argc == 4 ? atoi(argv[3]) : 1;
+
+  MeshFile::Data data = MeshFile::isBinary(in) ? MeshFile(in).data() : MeshFile::readText(in);
+  if (data.kind != MeshFile::Sol) {
+    cerr << in << " is not a solution" << endl;
+    return 1;
+  }
+
+  vector<VTUFile::Element> elts(data.elts.size());
+  int degree = 1;
+  for (size_t i = 0; i < elts.size(); i++) {
+    const MeshFile::Record &r = data.elts[i];
+    for (int k = 0; k < 3; k++) {
+      elts[i].xy[2*k] = data.xy[2*r.v[k]];
+      elts[i].xy[2*k + 1] = data.xy[2*r.v[k] + 1];
+    }
+    elts[i].tritype = r.type;
+    elts[i].u.assign(data.coeffs.begin() + data.rows[i], data.coeffs.begin() + data.rows[i + 1]);
+    degree = max(degree, Degree::dofToDegree(elts[i].u.size()));
+  }
+
+  VTUFile::write(elts, BasisEvaluator(degree), out, false, subdivision);
+  cerr << "Wrote " << out << endl;
+  return 0;
+}
@@ -0,0 +1,31 @@
+#include <iostream>
+#include <string>
+
+#include "../outputpolicy.h"
+
+using namespace std;
+
+/**
+ *  Rebuilds a solution written in delta mode:
+ *
+ *    undelta MANIFEST NAME [OUT]
+ *
+ *  writes solution NAME, as listed in MANIFEST, in full to OUT, or to NAME
+ *  in the directory of MANIFEST if OUT is not given.
+ */
+int main(int argc, char **argv) {
+  if (argc != 3 && argc != 4) {
+    cerr << "usage: " << argv[0] << " MANIFEST NAME [OUT]" << endl;
+    return 1;
+  }
+  string manifest = argv[1], name = argv[2];
+  string out = argc == 4 ? argv[3] : manifest.substr(0, manifest.find_last_of("/") + 1)
+                                + name.substr(name.find_last_of("/") + 1);
+
+  if (!OutputPolicy::reconstruct(manifest, name, out)) {
+    cerr << name << " is not listed in " << manifest << endl;
+    return 1;
+  }
+  cerr << "Wrote " << out << endl;
+  return 0;
+}
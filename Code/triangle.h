@@ -25,14 +25,19 @@ class Triangle : public Indexed {
     Triangle(Vertex *v[3], scalar _vol);
     Triangle(Vertex *v[3]);
 
+    // the barycentric coordinates of (x, y) with respect to v(0), v(1), v(2)
+    void barycentric(scalar x, scalar y, scalar lambda[3]) const {
+      lambda[1] = (_v[0]->y*_v[2]->x - _v[0]->x*_v[2]->y +
+          (_v[2]->y - _v[0]->y)*x + (_v[0]->x - _v[2]->x)*y)/(2*vol());
+      lambda[2] = (_v[0]->x*_v[1]->y - _v[0]->y*_v[1]->x +
+          (_v[0]->y - _v[1]->y)*x + (_v[1]->x - _v[0]->x)*y)/(2*vol());
+      lambda[0] = 1 - lambda[1] - lambda[2];
+    }
+
     bool contains(const Vertex *u) const {
-      scalar lambda0 = (_v[0]->y*_v[2]->x - _v[0]->x*_v[2]->y +
-          (_v[2]->y - _v[0]->y)*u->x + (_v[0]->x - _v[2]->x)*u->y)/(2*vol());
-      scalar lambda1 = (_v[0]->x*_v[1]->y - _v[0]->y*_v[1]->x +
-          (_v[0]->y - _v[1]->y)*u->x + (_v[1]->x - _v[0]->x)*u->y)/(2*vol());
-      scalar lambda2 = 1 - lambda0 - lambda1;
-      //std::cout << lambda0 << " " << lambda1 << " " << lambda2 << std::endl;
-      return (lambda0 >= -0.1) && (lambda1 >= -0.1) && (lambda2 >= -0.1);
+      scalar lambda[3];
+      barycentric(u->x, u->y, lambda);
+      return (lambda[0] >= -0.1) && (lambda[1] >= -0.1) && (lambda[2] >= -0.1);
     }
 
     bool contains(const Triangle* t) {
@@ -1,5 +1,6 @@
 #pragma once
 #include <set>
+#include <map>
 
 #include "triangle.h"
 #include "dofs.h"
@@ -35,7 +36,7 @@ typedef ElementPairMap<Dofs> ElementDofsMap;
 
 class TriangleSet {
 public:
-  static ElementSet unionSets(ElementSet s1, ElementSet s2) {
+  static ElementSet unionSets(const ElementSet &s1, const ElementSet &s2) {
     ElementSet res = s1;
     res.insert(s2.begin(), s2.end());
     return res;
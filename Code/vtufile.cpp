@@ -0,0 +1,195 @@
+#include <cassert>
+#include <cmath>
+#include <cstdint>
+#include <map>
+#include <memory>
+#include <tuple>
+
+#include "asyncwriter.h"
+#include "degree.h"
+#include "errors.h"
+#include "partition.h"
+#include "vtufile.h"
+
+using namespace std;
+
+namespace {
+const uint8_t VTKTriangle = 5;
+
+// the points (i/s, j/s), i + j <= s, of the reference triangle, row by row
+int latticeIndex(int i, int j, int s) { return j*(s + 1) - j*(j - 1)/2 + i; }
+
+// the arrays of the file, in the order they are appended
+struct Arrays {
+  vector<double> solution;
+  vector<int32_t> degree, tritype;
+  vector<double> error;
+  vector<double> points;
+  vector<int64_t> connectivity, offsets;
+  vector<uint8_t> types;
+};
+
+template<typename T>
+void append(ostream &os, const vector<T> &a) {
+  uint64_t bytes = a.size()*sizeof(T);
+  os.write((const char *) &bytes, sizeof(bytes));
+  os.write((const char *) a.data(), bytes);
+}
+
+void print(const Arrays &a, bool errors, ostream &os) {
+  uint64_t offset = 0;
+  auto array = [&](const char *type, const char *name, size_t bytes, int components = 1) {
+    os << "        <DataArray type=\"" << type << "\"";
+    if( name) os << " Name=\"" << name << "\"";
+    if( components > 1) os << " NumberOfComponents=\"" << components << "\"";
+    os << " format=\"appended\" offset=\"" << offset << "\"/>\n";
+    offset += sizeof(uint64_t) + bytes;
+  };
+
+  const uint16_t one = 1;
+  bool little = *(const char *) &one;
+  os << "<?xml version=\"1.0\"?>\n";
+  os << "<VTKFile type=\"UnstructuredGrid\" version=\"1.0\" byte_order=\""
+     << (little ? "LittleEndian" : "BigEndian") << "\" header_type=\"UInt64\">\n";
+  os << "  <UnstructuredGrid>\n";
+  os << "    <Piece NumberOfPoints=\"" << a.solution.size() << "\" NumberOfCells=\"" << a.types.size() << "\">\n";
+  os << "      <PointData Scalars=\"solution\">\n";
+  array("Float64", "solution", a.solution.size()*sizeof(double));
+  os << "      </PointData>\n";
+  os << "      <CellData Scalars=\"degree\">\n";
+  array("Int32", "degree", a.degree.size()*sizeof(int32_t));
+  array("Int32", "tritype", a.tritype.size()*sizeof(int32_t));
+  if( errors) array("Float64", "error", a.error.size()*sizeof(double));
+  os << "      </CellData>\n";
+  os << "      <Points>\n";
+  array("Float64", nullptr, a.points.size()*sizeof(double), 3);
+  os << "      </Points>\n";
+  os << "      <Cells>\n";
+  array("Int64", "connectivity", a.connectivity.size()*sizeof(int64_t));
+  array("Int64", "offsets", a.offsets.size()*sizeof(int64_t));
+  array("UInt8", "types", a.types.size());
+  os << "      </Cells>\n";
+  os << "    </Piece>\n";
+  os << "  </UnstructuredGrid>\n";
+  os << "  <AppendedData encoding=\"raw\">\n_";
+  append(os, a.solution);
+  append(os, a.degree);
+  append(os, a.tritype);
+  if( errors) append(os, a.error);
+  append(os, a.points);
+  append(os, a.connectivity);
+  append(os, a.offsets);
+  append(os, a.types);
+  os << "\n  </AppendedData>\n";
+  os << "</VTKFile>\n";
+}
+}
+
+void VTUFile::write(Partition &partition, const FEM::Solution &sol, const string &filename,
+                    const Errors *errors, int subdivision) {
+  // locallyAt materializes lazy restrictions, so this is done serially
+  vector<Element> elts;
+  elts.reserve(partition.leaves().size());
+  for( ::Element *leaf : partition.leaves()) {
+    Element elt;
+    for( int k = 0; k < 3; k++) {
+      elt.xy[2*k] = leaf->verts()[k]->x;
+      elt.xy[2*k + 1] = leaf->verts()[k]->y;
+    }
+    elt.tritype = leaf->type().toInt();
+    const Vector &u = sol.locallyAt(leaf);
+    elt.u.assign(u.data(), u.data() + u.rows());
+    if( errors) elt.error = sqrt(errors->on(leaf));
+    elts.push_back(move(elt));
+  }
+  write(elts, partition.bases().evaluator(), filename, errors != nullptr, subdivision);
+}
+
+void VTUFile::write(const vector<Element> &elts, const BasisEvaluator &evaluator,
+                    const string &filename, bool errors, int subdivision) {
+  // where the points and cells of every element start
+  size_t n = elts.size();
+  vector<int> levels(n);
+  vector<size_t> firstPoint(n + 1, 0), firstCell(n + 1, 0);
+  map<tuple<int, int, int>, Matrix> tables;
+  for( size_t k = 0; k < n; k++) {
+    int dim = elts[k].u.size();
+    assert(dim <= evaluator.dim() && "local vector of a higher degree than the bases");
+    int s = levels[k] = max(1, Degree::dofToDegree(dim))*subdivision;
+    firstPoint[k + 1] = firstPoint[k] + (s + 1)*(s + 2)/2;
+    firstCell[k + 1] = firstCell[k] + s*s;
+    tables[make_tuple(elts[k].tritype, dim, s)];
+  }
+
+  // the basis functions at the lattice points, for every kind of element
+  vector<pair<const tuple<int, int, int> *, Matrix *>> todo;
+  for( auto &t : tables) todo.push_back(make_pair(&t.first, &t.second));
+#pragma omp parallel for schedule(dynamic)
+  for( size_t t = 0; t < todo.size(); t++) {
+    int tt, dim, s;
+    tie(tt, dim, s) = *todo[t].first;
+    Vector x((s + 1)*(s + 2)/2), y(x.rows());
+    for( int j = 0; j <= s; j++) {
+      for( int i = 0; i + j <= s; i++) {
+        x[latticeIndex(i, j, s)] = (scalar) i/s;
+        y[latticeIndex(i, j, s)] = (scalar) j/s;
+      }
+    }
+    evaluator.evaluate(TriType(tt), x, y, dim, *todo[t].second);
+  }
+
+  auto a = make_shared<Arrays>();
+  size_t numPoints = firstPoint[n], numCells = firstCell[n];
+  a->solution.resize(numPoints);
+  a->points.resize(3*numPoints);
+  a->degree.resize(numCells);
+  a->tritype.resize(numCells);
+  if( errors) a->error.resize(numCells);
+  a->connectivity.resize(3*numCells);
+  a->offsets.resize(numCells);
+  a->types.assign(numCells, VTKTriangle);
+
+#pragma omp parallel for schedule(dynamic, 64)
+  for( size_t k = 0; k < n; k++) {
+    const Element &elt = elts[k];
+    int dim = elt.u.size(), s = levels[k];
+    const Matrix &table = tables.at(make_tuple(elt.tritype, dim, s));
+    Vector values = table * Eigen::Map<const Vector>(elt.u.data(), dim);
+
+    size_t p0 = firstPoint[k];
+    for( int j = 0; j <= s; j++) {
+      for( int i = 0; i + j <= s; i++) {
+        size_t p = p0 + latticeIndex(i, j, s);
+        scalar x = (scalar) i/s, y = (scalar) j/s;
+        a->points[3*p] = elt.xy[0] + x*(elt.xy[2] - elt.xy[0]) + y*(elt.xy[4] - elt.xy[0]);
+        a->points[3*p + 1] = elt.xy[1] + x*(elt.xy[3] - elt.xy[1]) + y*(elt.xy[5] - elt.xy[1]);
+        a->points[3*p + 2] = 0;
+        a->solution[p] = values[latticeIndex(i, j, s)];
+      }
+    }
+
+    // the upward triangles of the lattice, and the downward ones between them
+    size_t c = firstCell[k];
+    auto cell = [&](int i0, int i1, int i2) {
+      a->connectivity[3*c] = p0 + i0;
+      a->connectivity[3*c + 1] = p0 + i1;
+      a->connectivity[3*c + 2] = p0 + i2;
+      a->offsets[c] = 3*(c + 1);
+      a->degree[c] = Degree::dofToDegree(dim);
+      a->tritype[c] = elt.tritype;
+      if( errors) a->error[c] = elt.error;
+      c++;
+    };
+    for( int j = 0; j < s; j++) {
+      for( int i = 0; i + j < s; i++) {
+        cell(latticeIndex(i, j, s), latticeIndex(i + 1, j, s), latticeIndex(i, j + 1, s));
+        if( i + j < s - 1) {
+          cell(latticeIndex(i + 1, j, s), latticeIndex(i + 1, j + 1, s), latticeIndex(i, j + 1, s));
+        }
+      }
+    }
+    assert(c == firstCell[k + 1]);
+  }
+
+  AsyncWriter::instance().write(filename, [a, errors](ostream &os) { print(*a, errors, os); });
+}
@@ -0,0 +1,48 @@
+#pragma once
+
+#include <string>
+#include <vector>
+
+#include "basisevaluator.h"
+#include "config.h"
+
+class Errors;
+class Partition;
+namespace FEM { class Solution; }
+
+/**
+ *  VTUFile.h
+ *
+ *  Writes hp solutions as VTK unstructured grids (.vtu), which ParaView and
+ *  VisIt open directly.  Every element of degree p is subdivided uniformly
+ *  into (p*subdivision)^2 triangles, and the solution is evaluated at their
+ *  vertices with the BasisEvaluator; the elements are evaluated in parallel.
+ *  Neighbouring elements do not share points, so that the solution is shown
+ *  as it is on each element.
+ *
+ *  The file holds the point array "solution" and the cell arrays "degree",
+ *  "tritype" and, if errors are given, "error", the local error estimate on
+ *  the element.  The arrays are stored as raw binary appended data, in the
+ *  byte order of this machine, with 64-bit headers.
+ */
+class VTUFile {
+public:
+  // an element as read from a .sol file: its vertices, tritype and local vector
+  struct Element {
+    scalar xy[6];
+    int tritype;
+    std::vector<scalar> u;
+    scalar error = 0;
+  };
+
+  /**
+   *  Writes the solution `sol` on the leaves of `partition` to `filename`,
+   *  with the local errors of `errors` if given.  The file itself is written
+   *  by the AsyncWriter.
+   */
+  static void write(Partition &partition, const FEM::Solution &sol, const std::string &filename,
+                    const Errors *errors = nullptr, int subdivision = 1);
+
+  static void write(const std::vector<Element> &elts, const BasisEvaluator &evaluator,
+                    const std::string &filename, bool errors = false, int subdivision = 1);
+};